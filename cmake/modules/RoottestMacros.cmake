@@ -728,15 +728,22 @@ endmacro(ROOTTEST_SETUP_EXECTEST)
 #                            [COPY_TO_BUILDDIR file1 file2 ...])
 #                            [ENVIRONMENT ENV_VAR1=value1;ENV_VAR2=value2; ...]
 #                            [PROPERTIES prop1 value1 prop2 value2...]
+#                            [PERF [PERF_ZSCORE z]]
 #                           )
 #
 # This function defines a roottest test. It adds a number of additional
 # options on top of the ROOT defined ROOT_ADD_TEST.
 #
+# With PERF and roottest_perftrack=ON, the test is run through
+# scripts/pt_collector, which keeps the history of its wall time and memory
+# usage in ${roottest_perftrack_dir}. The test fails if its wall time or peak
+# memory exceeds the mean of the history by more than PERF_ZSCORE (default:
+# ${roottest_perftrack_zscore}) sigmas.
+#
 #-------------------------------------------------------------------------------
 function(ROOTTEST_ADD_TEST testname)
-  CMAKE_PARSE_ARGUMENTS(ARG "WILLFAIL;RUN_SERIAL"
-                            "OUTREF;ERRREF;OUTREF_CINTSPECIFIC;OUTCNV;PASSRC;MACROARG;WORKING_DIR;INPUT;ENABLE_IF;DISABLE_IF;TIMEOUT;RESOURCE_LOCK"
+  CMAKE_PARSE_ARGUMENTS(ARG "WILLFAIL;RUN_SERIAL;PERF"
+                            "OUTREF;ERRREF;OUTREF_CINTSPECIFIC;OUTCNV;PASSRC;MACROARG;WORKING_DIR;INPUT;ENABLE_IF;DISABLE_IF;TIMEOUT;RESOURCE_LOCK;PERF_ZSCORE"
                             "TESTOWNER;COPY_TO_BUILDDIR;MACRO;EXEC;COMMAND;PRECMD;POSTCMD;OUTCNVCMD;FAILREGEX;PASSREGEX;DEPENDS;OPTS;LABELS;ENVIRONMENT;FIXTURES_SETUP;FIXTURES_CLEANUP;FIXTURES_REQUIRED;PROPERTIES"
                             ${ARGN})
 
@@ -935,6 +942,29 @@ function(ROOTTEST_ADD_TEST testname)
     set(run_serial RUN_SERIAL ${ARG_RUN_SERIAL})
   endif()
 
+  # Wrap the test in the performance collector. Timings of concurrently
+  # running tests are meaningless, so run it serially.
+  if(ARG_PERF AND roottest_perftrack)
+    if(ARG_PERF_ZSCORE)
+      set(perf_zscore ${ARG_PERF_ZSCORE})
+    else()
+      set(perf_zscore ${roottest_perftrack_zscore})
+    endif()
+    set(command ${CMAKE_BINARY_DIR}/scripts/pt_collector
+                -n ${fulltestname}
+                -d ${roottest_perftrack_dir}
+                -p ${CMAKE_BINARY_DIR}/scripts/ptpreload${CMAKE_SHARED_MODULE_SUFFIX}
+                -z ${perf_zscore}
+                ${ROOTTEST_DIR}
+                ${command})
+    set(run_serial RUN_SERIAL TRUE)
+    if(labels)
+      list(APPEND labels perf)
+    else()
+      set(labels LABELS perf)
+    endif()
+  endif()
+
   if(MSVC)
     set(environment ENVIRONMENT
                     ${ROOTTEST_ENV_EXTRA}
@@ -0,0 +1,169 @@
+#ifndef ROOTTEST_BOUNDEDMERGE_H
+#define ROOTTEST_BOUNDEDMERGE_H
+
+// RDataFrame actions merging into one shared result under a memory budget.
+//
+// Histo1D/2D/3D and Take keep one full copy of the result per slot and merge
+// them at the end of the event loop: with a TH3 or THnSparse and 64 slots
+// that is 64 times the result. These actions keep a single result; every
+// slot buffers its values and fills them into the shared result, under a
+// lock, when its buffer is full. All buffers together take at most
+// budgetBytes, so the memory does not grow with the number of slots.
+//
+//    auto h = df.Book<double, double, double>(
+//       BoundedFill<TH3D>(std::make_shared<TH3D>("h", "", 100, 0, 1, 100, 0, 1, 100, 0, 1), nSlots, 64 << 20),
+//       {"x", "y", "z"});
+//    auto v = df.Book<double>(BoundedTake<double>(nSlots, 64 << 20), {"x"});
+//
+// The fills are unweighted. As for Take with several slots, the order of the
+// values taken is not the entry order.
+
+#include "ROOT/RDataFrame.hxx"
+#include "TH1.h"
+#include "TH2.h"
+#include "TH3.h"
+#include "THnBase.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// One buffer per slot, of at most budgetBytes / nSlots bytes each.
+template <typename T>
+class SlotBuffers {
+private:
+   std::vector<std::vector<T>> fBuffers;
+   size_t fCapacity;
+
+public:
+   SlotBuffers(unsigned nSlots, size_t budgetBytes, size_t itemsPerEntry)
+      : fBuffers(nSlots), fCapacity(std::max<size_t>(budgetBytes / nSlots / sizeof(T), itemsPerEntry))
+   {
+      for (auto &buf : fBuffers)
+         buf.reserve(fCapacity);
+   }
+
+   std::vector<T> &operator[](unsigned slot) { return fBuffers[slot]; }
+   bool IsFull(unsigned slot, size_t itemsPerEntry) const { return fBuffers[slot].size() + itemsPerEntry > fCapacity; }
+   unsigned GetNSlots() const { return fBuffers.size(); }
+};
+
+template <typename HIST>
+class BoundedFill : public ROOT::Detail::RDF::RActionImpl<BoundedFill<HIST>> {
+public:
+   using Result_t = HIST;
+
+private:
+   std::shared_ptr<HIST> fResult;
+   int fDim;
+   SlotBuffers<double> fBuffers; // fDim coordinates per entry
+   std::unique_ptr<std::mutex> fMutex{new std::mutex};
+
+   static int GetDimension(const TH1 &h) { return h.GetDimension(); }
+   static int GetDimension(const THnBase &h) { return h.GetNdimensions(); }
+
+   void FillOne(const double *x)
+   {
+      if constexpr (std::is_base_of<THnBase, HIST>::value) {
+         fResult->Fill(x);
+      } else {
+         TH1 &h = *fResult;
+         if (fDim == 1)
+            h.Fill(x[0]);
+         else if (fDim == 2)
+            static_cast<TH2 &>(h).Fill(x[0], x[1]);
+         else
+            static_cast<TH3 &>(h).Fill(x[0], x[1], x[2]);
+      }
+   }
+
+   void Flush(unsigned slot)
+   {
+      std::vector<double> &buf = fBuffers[slot];
+      for (size_t i = 0; i < buf.size(); i += fDim)
+         FillOne(&buf[i]);
+      buf.clear();
+   }
+
+public:
+   BoundedFill(std::shared_ptr<HIST> result, unsigned nSlots, size_t budgetBytes)
+      : fResult(result), fDim(GetDimension(*result)), fBuffers(nSlots, budgetBytes, fDim)
+   {
+      if constexpr (std::is_base_of<TH1, HIST>::value)
+         fResult->SetDirectory(nullptr);
+   }
+   BoundedFill(BoundedFill &&) = default;
+
+   std::shared_ptr<HIST> GetResultPtr() const { return fResult; }
+   void Initialize() {}
+   void InitTask(TTreeReader *, unsigned) {}
+
+   template <typename... Coords>
+   void Exec(unsigned slot, Coords... x)
+   {
+      static_assert(sizeof...(Coords) <= 3 || std::is_base_of<THnBase, HIST>::value, "TH1 has at most 3 dimensions");
+      std::vector<double> &buf = fBuffers[slot];
+      for (double v : {double(x)...})
+         buf.push_back(v);
+      if (fBuffers.IsFull(slot, fDim)) {
+         std::lock_guard<std::mutex> lock(*fMutex);
+         Flush(slot);
+      }
+   }
+
+   void Finalize()
+   {
+      for (unsigned slot = 0; slot < fBuffers.GetNSlots(); ++slot)
+         Flush(slot);
+   }
+
+   std::string GetActionName() { return "BoundedFill"; }
+};
+
+template <typename T>
+class BoundedTake : public ROOT::Detail::RDF::RActionImpl<BoundedTake<T>> {
+public:
+   using Result_t = std::vector<T>;
+
+private:
+   std::shared_ptr<std::vector<T>> fResult{new std::vector<T>};
+   SlotBuffers<T> fBuffers;
+   std::unique_ptr<std::mutex> fMutex{new std::mutex};
+
+   void Flush(unsigned slot)
+   {
+      std::vector<T> &buf = fBuffers[slot];
+      fResult->insert(fResult->end(), buf.begin(), buf.end());
+      buf.clear();
+   }
+
+public:
+   BoundedTake(unsigned nSlots, size_t budgetBytes) : fBuffers(nSlots, budgetBytes, 1) {}
+   BoundedTake(BoundedTake &&) = default;
+
+   std::shared_ptr<std::vector<T>> GetResultPtr() const { return fResult; }
+   void Initialize() {}
+   void InitTask(TTreeReader *, unsigned) {}
+
+   void Exec(unsigned slot, const T &value)
+   {
+      fBuffers[slot].push_back(value);
+      if (fBuffers.IsFull(slot, 1)) {
+         std::lock_guard<std::mutex> lock(*fMutex);
+         Flush(slot);
+      }
+   }
+
+   void Finalize()
+   {
+      for (unsigned slot = 0; slot < fBuffers.GetNSlots(); ++slot)
+         Flush(slot);
+   }
+
+   std::string GetActionName() { return "BoundedTake"; }
+};
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef ROOTTEST_JITCACHE_H
+#define ROOTTEST_JITCACHE_H
+
+// On-disk cache of compiled RDataFrame string expressions.
+//
+// A string Filter or Define is jitted by cling in every process. Here the
+// expression is instead turned into a small source file that adds the node
+// with a typed lambda, compiled once with ACLiC into a library named after
+// the MD5 of the expression, the column names and types, the kind of node
+// and the ROOT version. Later processes only load the library.
+//
+//    JitCache cache("jitcache");
+//    ROOT::RDF::RNode n = cache.Filter(df, "x > 0.5 && y % 3 == 0");
+//    n = cache.Define(n, "z", "x * y + Sum(v)");
+//
+// The columns of an expression are the identifiers that are column names of
+// the node; ROOT::VecOps is visible, as for jitted expressions. Concurrent
+// processes compiling the same expression are serialized by a lock file; the
+// library is compiled under another name and renamed when complete.
+
+#include "ROOT/RDataFrame.hxx"
+#include "TError.h"
+#include "TLockFile.h"
+#include "TMD5.h"
+#include "TROOT.h"
+#include "TSystem.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+class JitCache {
+private:
+   std::string fDir;
+   int fHits = 0;
+   int fMisses = 0;
+
+   using NodeFunc_t = void *(*)(void *node, const char *name);
+
+   static std::vector<std::string> FindColumns(ROOT::RDF::RNode &node, const std::string &expr)
+   {
+      const auto names = node.GetColumnNames();
+      std::vector<std::string> columns;
+      for (size_t i = 0; i < expr.size();) {
+         if (!isalpha(expr[i]) && expr[i] != '_') {
+            ++i;
+            continue;
+         }
+         size_t j = i;
+         while (j < expr.size() && (isalnum(expr[j]) || expr[j] == '_'))
+            ++j;
+         std::string id = expr.substr(i, j - i);
+         const bool member = i > 0 && expr[i - 1] == '.';
+         if (!member && std::find(names.begin(), names.end(), id) != names.end() &&
+             std::find(columns.begin(), columns.end(), id) == columns.end())
+            columns.push_back(id);
+         i = j;
+      }
+      return columns;
+   }
+
+   NodeFunc_t GetFunction(ROOT::RDF::RNode &node, const std::string &kind, const std::string &expr)
+   {
+      const std::vector<std::string> columns = FindColumns(node, expr);
+      std::string signature, names;
+      for (const std::string &col : columns) {
+         signature += (signature.empty() ? "" : ", ") + std::string("const ") + node.GetColumnType(col) + " &" + col;
+         names += (names.empty() ? "\"" : ", \"") + col + "\"";
+      }
+      std::string key = kind + "\n" + expr + "\n" + signature + "\n" + gROOT->GetVersion();
+      TMD5 md5;
+      md5.Update(reinterpret_cast<const UChar_t *>(key.data()), key.size());
+      md5.Final();
+      const std::string func = std::string("jc_") + md5.AsString();
+      const std::string source = fDir + "/" + func + ".C";
+      const std::string library = fDir + "/" + func + "_C." + gSystem->GetSoExt();
+
+      if (gSystem->AccessPathName(library.c_str())) {
+         TLockFile lock((source + ".lock").c_str(), 600);
+         // Another process may have compiled it while we waited for the lock.
+         if (gSystem->AccessPathName(library.c_str())) {
+            ++fMisses;
+            FILE *out = fopen(source.c_str(), "w");
+            if (!out)
+               throw std::runtime_error("JitCache: cannot write " + source);
+            fprintf(out, "// %s: %s\n", kind.c_str(), expr.c_str());
+            fprintf(out, "#include \"ROOT/RDataFrame.hxx\"\n#include \"ROOT/RVec.hxx\"\n#include <cmath>\n");
+            fprintf(out, "using namespace ROOT::VecOps;\n\n");
+            fprintf(out, "extern \"C\" void *%s(void *node, const char *name)\n{\n", func.c_str());
+            fprintf(out, "   auto &in = *static_cast<ROOT::RDF::RNode *>(node);\n");
+            fprintf(out, "   auto f = [](%s) { return %s; };\n", signature.c_str(), expr.c_str());
+            if (kind == "Filter")
+               fprintf(out, "   return new ROOT::RDF::RNode(in.Filter(f, {%s}, name));\n}\n", names.c_str());
+            else
+               fprintf(out, "   return new ROOT::RDF::RNode(in.Define(name, f, {%s}));\n}\n", names.c_str());
+            fclose(out);
+            // Compile to a name of our own and rename it into place, so that
+            // the library only exists once it is complete for processes that
+            // find it without taking the lock.
+            const std::string building = fDir + "/" + func + "_" + std::to_string(gSystem->GetPid()) + "_C";
+            const std::string built = building + "." + gSystem->GetSoExt();
+            if (!gSystem->CompileMacro(source.c_str(), "kOn", building.c_str()))
+               throw std::runtime_error("JitCache: cannot compile " + source);
+            if (rename(built.c_str(), library.c_str()) != 0)
+               throw std::runtime_error("JitCache: cannot rename " + built + " to " + library);
+         } else {
+            ++fHits;
+         }
+      } else {
+         ++fHits;
+      }
+      if (gSystem->Load(library.c_str()) < 0)
+         throw std::runtime_error("JitCache: cannot load " + library);
+      auto f = reinterpret_cast<NodeFunc_t>(gSystem->DynFindSymbol(library.c_str(), func.c_str()));
+      if (!f)
+         throw std::runtime_error("JitCache: no " + func + " in " + library);
+      return f;
+   }
+
+   ROOT::RDF::RNode Add(ROOT::RDF::RNode node, const std::string &kind, const std::string &expr, const std::string &name)
+   {
+      NodeFunc_t f = GetFunction(node, kind, expr);
+      std::unique_ptr<ROOT::RDF::RNode> result(static_cast<ROOT::RDF::RNode *>(f(&node, name.c_str())));
+      return *result;
+   }
+
+public:
+   JitCache(const std::string &dir = "jitcache") : fDir(dir) { gSystem->mkdir(fDir.c_str(), kTRUE); }
+
+   ROOT::RDF::RNode Filter(ROOT::RDF::RNode node, const std::string &expr, const std::string &name = "")
+   {
+      return Add(node, "Filter", expr, name);
+   }
+
+   ROOT::RDF::RNode Define(ROOT::RDF::RNode node, const std::string &column, const std::string &expr)
+   {
+      return Add(node, "Define", expr, column);
+   }
+
+   int GetHits() const { return fHits; }
+   int GetMisses() const { return fMisses; }
+};
+
+#endif
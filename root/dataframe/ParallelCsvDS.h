@@ -0,0 +1,429 @@
+#ifndef ROOTTEST_PARALLELCSVDS_H
+#define ROOTTEST_PARALLELCSVDS_H
+
+// RDataFrame data source for CSV files, parsed in parallel.
+//
+// RCsvDS parses the file in GetEntryRanges, i.e. serially. Here the file is
+// memory mapped and cut into chunks at line boundaries; Initialize counts
+// the lines of the chunks in parallel (to number the entries) and every
+// slot parses the chunks it is given by the event loop, so parsing scales
+// with the slots and at most one chunk per slot is held in parsed form.
+//
+//    auto df = MakeParallelCsvDataFrame("file.csv");
+//
+// As RCsvDS, the column types are inferred from the first data line:
+// Long64_t, double, bool (true/false) or std::string, and fields can be
+// quoted with ". Line boundaries are found with memchr; numbers go through a
+// fast path for plain decimals and fall back to strtod for anything else.
+
+#include "ROOT/RDataFrame.hxx"
+#include "ROOT/RDataSource.hxx"
+#include "ROOT/RStringView.hxx"
+#include "RConfigure.h"
+#include "TROOT.h"
+#ifdef R__USE_IMT
+#include "ROOT/TSeq.hxx"
+#include "ROOT/TThreadExecutor.hxx"
+#endif
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+class ParallelCsvDS final : public ROOT::RDF::RDataSource {
+public:
+   enum EType : char { kLong = 'L', kDouble = 'D', kBool = 'O', kString = 'T' };
+
+private:
+   struct Chunk {
+      const char *fBegin;
+      const char *fEnd;
+      ULong64_t fFirstEntry = 0;
+      ULong64_t fNLines = 0;
+   };
+
+   // The parsed chunk of a slot, column major, and the addresses read by RDataFrame.
+   struct SlotData {
+      ULong64_t fFirstEntry = 0;
+      std::vector<std::vector<Long64_t>> fLongs;
+      std::vector<std::vector<double>> fDoubles;
+      std::vector<std::unique_ptr<bool[]>> fBools;
+      std::vector<std::vector<std::string>> fStrings;
+      std::vector<void *> fAddresses; // per column, a pointer to the current value
+   };
+
+   std::string fFileName;
+   char fDelimiter;
+   unsigned fNChunksHint;
+   int fFd = -1;
+   const char *fData = nullptr;
+   size_t fSize = 0;
+   const char *fDataBegin = nullptr; // behind the header
+   std::vector<std::string> fColumnNames;
+   std::vector<EType> fColumnTypes;
+   std::vector<Chunk> fChunks;
+   std::vector<SlotData> fSlots;
+   unsigned fNSlots = 0;
+   bool fRangesGiven = false;
+
+   static const char *LineEnd(const char *p, const char *end)
+   {
+      if (p >= end)
+         return end;
+      auto nl = static_cast<const char *>(memchr(p, '\n', end - p));
+      return nl ? nl : end;
+   }
+
+   static const char *TrimCR(const char *begin, const char *end) { return end > begin && end[-1] == '\r' ? end - 1 : end; }
+
+   // Calls f(index, begin, end) for the fields of the line [p, lineEnd) until f returns false.
+   template <typename F>
+   void ForEachField(const char *p, const char *lineEnd, F f) const
+   {
+      for (size_t index = 0;; ++index) {
+         const char *begin = p, *end;
+         if (p < lineEnd && *p == '"') {
+            begin = p + 1;
+            auto quote = static_cast<const char *>(memchr(begin, '"', lineEnd - begin));
+            end = quote ? quote : lineEnd;
+            p = quote ? quote + 1 : lineEnd;
+            auto delim = static_cast<const char *>(memchr(p, fDelimiter, lineEnd - p));
+            p = delim ? delim : lineEnd;
+         } else {
+            auto delim = static_cast<const char *>(memchr(p, fDelimiter, lineEnd - p));
+            end = delim ? delim : lineEnd;
+            p = end;
+         }
+         if (!f(index, begin, end) || p == lineEnd)
+            return;
+         ++p; // the delimiter
+      }
+   }
+
+public:
+   static bool ParseLong(const char *begin, const char *end, Long64_t &value)
+   {
+      const char *p = begin;
+      bool negative = false;
+      if (p < end && (*p == '-' || *p == '+'))
+         negative = *p++ == '-';
+      if (p == end || end - p > 18)
+         return false;
+      Long64_t v = 0;
+      for (; p < end; ++p) {
+         unsigned digit = *p - '0';
+         if (digit > 9)
+            return false;
+         v = 10 * v + digit;
+      }
+      value = negative ? -v : v;
+      return true;
+   }
+
+   static bool ParseDouble(const char *begin, const char *end, double &value)
+   {
+      // Fast path: up to 15 significant digits and no exponent, where
+      // mantissa / 10^n is exact in both factors and hence correctly rounded.
+      static const double kPow10[] = {1e0, 1e1, 1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                      1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+      const char *p = begin;
+      bool negative = false;
+      if (p < end && (*p == '-' || *p == '+'))
+         negative = *p++ == '-';
+      Long64_t mantissa = 0;
+      int digits = 0, decimals = -1;
+      for (; p < end; ++p) {
+         unsigned digit = *p - '0';
+         if (digit <= 9) {
+            mantissa = 10 * mantissa + digit;
+            ++digits;
+            if (decimals >= 0)
+               ++decimals;
+         } else if (*p == '.' && decimals < 0) {
+            decimals = 0;
+         } else {
+            break;
+         }
+      }
+      if (p == end && digits > 0 && digits <= 15) {
+         value = double(mantissa) / kPow10[std::max(decimals, 0)];
+         if (negative)
+            value = -value;
+         return true;
+      }
+      // General case
+      std::string field(begin, end);
+      char *parsed = nullptr;
+      value = strtod(field.c_str(), &parsed);
+      return !field.empty() && parsed == field.c_str() + field.size();
+   }
+
+   ParallelCsvDS(std::string_view fileName, bool readHeader = true, char delimiter = ',', unsigned nChunks = 0)
+      : fFileName(fileName), fDelimiter(delimiter), fNChunksHint(nChunks)
+   {
+      fFd = open(fFileName.c_str(), O_RDONLY);
+      struct stat st;
+      if (fFd < 0 || fstat(fFd, &st) != 0)
+         throw std::runtime_error("ParallelCsvDS: cannot open file " + fFileName);
+      fSize = st.st_size;
+      if (fSize > 0) {
+         void *data = mmap(nullptr, fSize, PROT_READ, MAP_PRIVATE, fFd, 0);
+         if (data == MAP_FAILED) {
+            close(fFd);
+            throw std::runtime_error("ParallelCsvDS: cannot map file " + fFileName);
+         }
+         fData = static_cast<const char *>(data);
+      }
+      const char *end = fData + fSize;
+      const char *p = fData;
+
+      // Header, or the number of fields of the first line.
+      const char *lineEnd = LineEnd(p, end);
+      const char *lineStop = TrimCR(p, lineEnd);
+      std::vector<std::string> fields;
+      ForEachField(p, lineStop, [&fields](size_t, const char *b, const char *e) {
+         fields.emplace_back(b, e);
+         return true;
+      });
+      if (readHeader) {
+         fColumnNames = fields;
+         p = lineEnd < end ? lineEnd + 1 : end;
+      } else {
+         for (size_t i = 0; i < fields.size(); ++i)
+            fColumnNames.push_back("Col" + std::to_string(i));
+      }
+      fDataBegin = p;
+
+      // Infer the types from the first data line.
+      lineEnd = LineEnd(p, end);
+      lineStop = TrimCR(p, lineEnd);
+      std::vector<std::string> values(fColumnNames.size());
+      ForEachField(p, lineStop, [&values](size_t i, const char *b, const char *e) {
+         if (i < values.size())
+            values[i].assign(b, e);
+         return i + 1 < values.size();
+      });
+      for (const std::string &value : values) {
+         const char *b = value.data(), *e = value.data() + value.size();
+         Long64_t l;
+         double d;
+         if (ParseLong(b, e, l))
+            fColumnTypes.push_back(kLong);
+         else if (ParseDouble(b, e, d))
+            fColumnTypes.push_back(kDouble);
+         else if (value == "true" || value == "false")
+            fColumnTypes.push_back(kBool);
+         else
+            fColumnTypes.push_back(kString);
+      }
+   }
+
+   ~ParallelCsvDS() override
+   {
+      if (fData)
+         munmap(const_cast<char *>(fData), fSize);
+      if (fFd >= 0)
+         close(fFd);
+   }
+
+   void SetNSlots(unsigned int nSlots) override
+   {
+      fNSlots = nSlots;
+      fSlots.resize(nSlots);
+      const size_t ncols = fColumnNames.size();
+      for (SlotData &slot : fSlots) {
+         slot.fLongs.resize(ncols);
+         slot.fDoubles.resize(ncols);
+         slot.fBools.resize(ncols);
+         slot.fStrings.resize(ncols);
+         slot.fAddresses.resize(ncols, nullptr);
+      }
+   }
+
+   const std::vector<std::string> &GetColumnNames() const override { return fColumnNames; }
+
+   bool HasColumn(std::string_view colName) const override
+   {
+      return std::find(fColumnNames.begin(), fColumnNames.end(), colName) != fColumnNames.end();
+   }
+
+   std::string GetTypeName(std::string_view colName) const override
+   {
+      auto iter = std::find(fColumnNames.begin(), fColumnNames.end(), colName);
+      if (iter == fColumnNames.end())
+         throw std::runtime_error("ParallelCsvDS: no column " + std::string(colName));
+      switch (fColumnTypes[iter - fColumnNames.begin()]) {
+      case kLong: return "Long64_t";
+      case kDouble: return "double";
+      case kBool: return "bool";
+      default: return "std::string";
+      }
+   }
+
+   void Initialize() override
+   {
+      // Cut the data into chunks at line boundaries and count their lines in parallel.
+      fRangesGiven = false;
+      if (!fChunks.empty())
+         return;
+      const char *end = fData + fSize;
+      const size_t bytes = end - fDataBegin;
+      size_t nchunks = fNChunksHint ? fNChunksHint : 4 * std::max(1u, fNSlots);
+      nchunks = std::max<size_t>(1, std::min(nchunks, bytes / (1 << 16)));
+      const char *begin = fDataBegin;
+      for (size_t i = 1; i <= nchunks && begin < end; ++i) {
+         const char *stop = i == nchunks ? end : fDataBegin + bytes * i / nchunks;
+         if (stop < begin)
+            continue;
+         stop = LineEnd(stop, end);
+         stop = stop < end ? stop + 1 : end;
+         fChunks.push_back({begin, stop});
+         begin = stop;
+      }
+
+      auto countLines = [this](unsigned i) {
+         const Chunk &chunk = fChunks[i];
+         ULong64_t lines = 0;
+         for (const char *p = chunk.fBegin; p < chunk.fEnd;) {
+            const char *lineEnd = LineEnd(p, chunk.fEnd);
+            if (TrimCR(p, lineEnd) > p)
+               ++lines;
+            p = lineEnd + 1;
+         }
+         return lines;
+      };
+      std::vector<ULong64_t> lines(fChunks.size());
+#ifdef R__USE_IMT
+      if (ROOT::IsImplicitMTEnabled()) {
+         ROOT::TThreadExecutor pool;
+         lines = pool.Map(countLines, ROOT::TSeqU(fChunks.size()));
+      } else
+#endif
+      {
+         for (unsigned i = 0; i < fChunks.size(); ++i)
+            lines[i] = countLines(i);
+      }
+      ULong64_t first = 0;
+      for (size_t i = 0; i < fChunks.size(); ++i) {
+         fChunks[i].fFirstEntry = first;
+         fChunks[i].fNLines = lines[i];
+         first += lines[i];
+      }
+   }
+
+   std::vector<std::pair<ULong64_t, ULong64_t>> GetEntryRanges() override
+   {
+      std::vector<std::pair<ULong64_t, ULong64_t>> ranges;
+      if (fRangesGiven)
+         return ranges;
+      fRangesGiven = true;
+      for (const Chunk &chunk : fChunks) {
+         if (chunk.fNLines > 0)
+            ranges.emplace_back(chunk.fFirstEntry, chunk.fFirstEntry + chunk.fNLines);
+      }
+      return ranges;
+   }
+
+   void InitSlot(unsigned int slot, ULong64_t firstEntry) override
+   {
+      // Parse the chunk starting at firstEntry into the buffers of slot.
+      auto iter = std::upper_bound(fChunks.begin(), fChunks.end(), firstEntry,
+                                   [](ULong64_t entry, const Chunk &chunk) { return entry < chunk.fFirstEntry; });
+      const Chunk &chunk = *(iter - 1);
+      SlotData &data = fSlots[slot];
+      data.fFirstEntry = chunk.fFirstEntry;
+      const size_t ncols = fColumnNames.size();
+      const size_t nlines = chunk.fNLines;
+      for (size_t c = 0; c < ncols; ++c) {
+         switch (fColumnTypes[c]) {
+         case kLong: data.fLongs[c].assign(nlines, 0); break;
+         case kDouble: data.fDoubles[c].assign(nlines, 0.); break;
+         case kBool: data.fBools[c].reset(new bool[nlines]()); break;
+         case kString: data.fStrings[c].assign(nlines, std::string()); break;
+         }
+      }
+      size_t line = 0;
+      for (const char *p = chunk.fBegin; p < chunk.fEnd && line < nlines;) {
+         const char *lineEnd = LineEnd(p, chunk.fEnd);
+         const char *lineStop = TrimCR(p, lineEnd);
+         if (lineStop > p) {
+            ForEachField(p, lineStop, [&](size_t c, const char *b, const char *e) {
+               if (c >= ncols)
+                  return false;
+               switch (fColumnTypes[c]) {
+               case kLong: ParseLong(b, e, data.fLongs[c][line]); break;
+               case kDouble:
+                  if (b == e || !ParseDouble(b, e, data.fDoubles[c][line]))
+                     data.fDoubles[c][line] = std::numeric_limits<double>::quiet_NaN();
+                  break;
+               case kBool: data.fBools[c][line] = e - b == 4 && memcmp(b, "true", 4) == 0; break;
+               case kString: data.fStrings[c][line].assign(b, e); break;
+               }
+               return true;
+            });
+            ++line;
+         }
+         p = lineEnd + 1;
+      }
+   }
+
+   bool SetEntry(unsigned int slot, ULong64_t entry) override
+   {
+      SlotData &data = fSlots[slot];
+      const size_t index = entry - data.fFirstEntry;
+      for (size_t c = 0; c < fColumnNames.size(); ++c) {
+         switch (fColumnTypes[c]) {
+         case kLong: data.fAddresses[c] = &data.fLongs[c][index]; break;
+         case kDouble: data.fAddresses[c] = &data.fDoubles[c][index]; break;
+         case kBool: data.fAddresses[c] = &data.fBools[c][index]; break;
+         case kString: data.fAddresses[c] = &data.fStrings[c][index]; break;
+         }
+      }
+      return true;
+   }
+
+   std::string GetLabel() override { return "ParallelCsv"; }
+
+protected:
+   Record_t GetColumnReadersImpl(std::string_view colName, const std::type_info &id) override
+   {
+      auto iter = std::find(fColumnNames.begin(), fColumnNames.end(), colName);
+      if (iter == fColumnNames.end())
+         throw std::runtime_error("ParallelCsvDS: no column " + std::string(colName));
+      const size_t c = iter - fColumnNames.begin();
+      const std::type_info *expected = nullptr;
+      switch (fColumnTypes[c]) {
+      case kLong: expected = &typeid(Long64_t); break;
+      case kDouble: expected = &typeid(double); break;
+      case kBool: expected = &typeid(bool); break;
+      case kString: expected = &typeid(std::string); break;
+      }
+      if (id != *expected)
+         throw std::runtime_error("ParallelCsvDS: column " + std::string(colName) + " has type " +
+                                  GetTypeName(colName));
+      Record_t readers;
+      for (SlotData &slot : fSlots)
+         readers.push_back(&slot.fAddresses[c]);
+      return readers;
+   }
+};
+
+inline ROOT::RDataFrame
+MakeParallelCsvDataFrame(std::string_view fileName, bool readHeader = true, char delimiter = ',', unsigned nChunks = 0)
+{
+   return ROOT::RDataFrame(std::make_unique<ParallelCsvDS>(fileName, readHeader, delimiter, nChunks));
+}
+
+#endif
@@ -0,0 +1,225 @@
+#ifndef ROOTTEST_PARALLELSNAPSHOT_H
+#define ROOTTEST_PARALLELSNAPSHOT_H
+
+// Snapshot of RDataFrame columns with a dedicated output thread.
+//
+// Every slot fills its own TTree in a TMemFile, i.e. serializes and
+// compresses the baskets in parallel. Every clusterEntries entries the slot
+// hands the TMemFile over to a single writer thread, which appends its
+// compressed baskets to the output tree without decompressing them
+// (TTree::CopyEntries "fast"), so the slots never wait for the output file.
+//
+//    ParallelSnapshot snap("tree", "out.root", df.GetNSlots());
+//    snap.Run<int, double>(df, {"i", "x"});
+//
+// Entries are written in the order in which the chunks complete. With
+// ordered = true, chunks also end at the end of each task of the event loop
+// and are sorted by their first rdfentry_, which for a single input tree is
+// the order of a sequential Snapshot; the chunks are then kept until the end
+// of the event loop, i.e. the compressed output is buffered in memory.
+
+#include "ROOT/RDataFrame.hxx"
+#include "Compression.h"
+#include "TDirectory.h"
+#include "TFile.h"
+#include "TMemFile.h"
+#include "TROOT.h"
+#include "TTree.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+class ParallelSnapshot {
+private:
+   struct Chunk {
+      ULong64_t fFirstEntry; // rdfentry_ of the first entry
+      std::unique_ptr<TMemFile> fFile;
+   };
+
+   std::string fTreeName;
+   std::unique_ptr<TFile> fOutFile;
+   TTree *fOutTree = nullptr; // owned by fOutFile
+   unsigned fNSlots;
+   Long64_t fClusterEntries;
+   int fCompression;
+   bool fOrdered;
+
+   std::mutex fMutex;
+   std::condition_variable fCondition;
+   std::deque<Chunk> fQueue;
+   bool fDone = false;
+   std::thread fWriter;
+   Long64_t fNChunks = 0;
+   Long64_t fMaxQueued = 0;
+   std::atomic<ULong64_t> fNTasks{0};
+
+   void Append(Chunk &chunk)
+   {
+      // Writer thread only.
+      TTree *in = nullptr;
+      chunk.fFile->GetObject(fTreeName.c_str(), in);
+      if (!in)
+         return;
+      if (!fOutTree) {
+         TDirectory::TContext ctx(fOutFile.get());
+         fOutTree = in->CloneTree(0);
+         fOutTree->SetAutoFlush(0);
+      }
+      fOutTree->CopyEntries(in, -1, "fast");
+      ++fNChunks;
+   }
+
+   void WriterLoop()
+   {
+      std::map<ULong64_t, Chunk> ordered;
+      std::unique_lock<std::mutex> lock(fMutex);
+      while (true) {
+         fCondition.wait(lock, [this] { return fDone || !fQueue.empty(); });
+         if (fQueue.empty() && fDone)
+            break;
+         Chunk chunk = std::move(fQueue.front());
+         fQueue.pop_front();
+         lock.unlock();
+         if (fOrdered)
+            ordered.emplace(chunk.fFirstEntry, std::move(chunk));
+         else
+            Append(chunk);
+         lock.lock();
+      }
+      lock.unlock();
+      for (auto &entry : ordered)
+         Append(entry.second);
+   }
+
+   void Push(Chunk &&chunk)
+   {
+      std::lock_guard<std::mutex> lock(fMutex);
+      fQueue.push_back(std::move(chunk));
+      fMaxQueued = std::max<Long64_t>(fMaxQueued, fQueue.size());
+      fCondition.notify_one();
+   }
+
+   template <typename... ColTypes>
+   struct SlotOutput {
+      std::unique_ptr<TMemFile> fFile;
+      TTree *fTree = nullptr; // owned by fFile
+      std::tuple<ColTypes...> fValues;
+      ULong64_t fFirstEntry = 0;
+      ULong64_t fTask = 0;
+   };
+
+   template <typename... ColTypes, std::size_t... S>
+   void OpenChunk(SlotOutput<ColTypes...> &out, unsigned slot, const std::vector<std::string> &columns,
+                  std::index_sequence<S...>)
+   {
+      const std::string name = "ParallelSnapshot_" + std::to_string(slot) + ".root";
+      out.fFile.reset(new TMemFile(name.c_str(), "RECREATE", "", fCompression));
+      TDirectory::TContext ctx(out.fFile.get());
+      out.fTree = new TTree(fTreeName.c_str(), fTreeName.c_str());
+      out.fTree->SetAutoFlush(0); // one cluster per chunk
+      out.fTree->SetImplicitMT(false);
+      int expand[] = {(out.fTree->Branch(columns[S].c_str(), &std::get<S>(out.fValues)), 0)..., 0};
+      (void)expand;
+   }
+
+   template <typename... ColTypes>
+   void CloseChunk(SlotOutput<ColTypes...> &out)
+   {
+      if (!out.fFile)
+         return;
+      if (out.fTree->GetEntries() > 0) {
+         out.fFile->Write();
+         Push({out.fFirstEntry, std::move(out.fFile)});
+      }
+      out.fFile.reset();
+      out.fTree = nullptr;
+   }
+
+   template <typename... ColTypes>
+   struct FillSlot {
+      ParallelSnapshot *fSnapshot;
+      std::vector<SlotOutput<ColTypes...>> *fOutputs;
+      const std::vector<std::string> *fColumns;
+
+      void operator()(unsigned slot, ULong64_t task, ULong64_t entry, const ColTypes &...values)
+      {
+         auto &out = (*fOutputs)[slot];
+         // A chunk ends when full or, if ordered, at the end of a task.
+         const bool sameTask = !fSnapshot->fOrdered || task == out.fTask;
+         if (out.fFile && (!sameTask || out.fTree->GetEntries() >= fSnapshot->fClusterEntries))
+            fSnapshot->CloseChunk(out);
+         if (!out.fFile) {
+            fSnapshot->OpenChunk(out, slot, *fColumns, std::index_sequence_for<ColTypes...>());
+            out.fFirstEntry = entry;
+            out.fTask = task;
+         }
+         out.fValues = std::make_tuple(values...);
+         out.fTree->Fill();
+      }
+   };
+
+public:
+   ParallelSnapshot(const std::string &treeName, const std::string &fileName, unsigned nSlots,
+                    Long64_t clusterEntries = 10000, int compression = ROOT::RCompressionSetting::EDefaults::kUseGeneralPurpose,
+                    bool ordered = false)
+      : fTreeName(treeName), fOutFile(TFile::Open(fileName.c_str(), "RECREATE", "", compression)), fNSlots(nSlots),
+        fClusterEntries(clusterEntries), fCompression(compression), fOrdered(ordered)
+   {
+      ROOT::EnableThreadSafety(); // for the writer thread
+   }
+
+   ~ParallelSnapshot() { Finish(); }
+
+   template <typename... ColTypes>
+   void Run(ROOT::RDF::RNode df, const std::vector<std::string> &columns)
+   {
+      // Runs the event loop of df, writing columns; can be called once.
+      if (!fOutFile || fOutFile->IsZombie() || fWriter.joinable())
+         return;
+      fWriter = std::thread([this] { WriterLoop(); });
+      std::vector<SlotOutput<ColTypes...>> outputs(fNSlots);
+      // a number unique to each task of each slot
+      auto withTask = df.DefinePerSample("parallelSnapshotTask_",
+                                         [this](unsigned, const ROOT::RDF::RSampleInfo &) { return ++fNTasks; });
+      std::vector<std::string> allColumns{"parallelSnapshotTask_", "rdfentry_"};
+      allColumns.insert(allColumns.end(), columns.begin(), columns.end());
+      withTask.ForeachSlot(FillSlot<ColTypes...>{this, &outputs, &columns}, allColumns);
+      for (auto &out : outputs)
+         CloseChunk(out);
+      Finish();
+   }
+
+   void Finish()
+   {
+      // Waits for the writer thread and closes the output file.
+      if (fWriter.joinable()) {
+         {
+            std::lock_guard<std::mutex> lock(fMutex);
+            fDone = true;
+         }
+         fCondition.notify_one();
+         fWriter.join();
+      }
+      if (fOutFile && !fOutFile->IsZombie()) {
+         fOutFile->Write();
+         fOutFile->Close();
+      }
+      fOutFile.reset();
+      fOutTree = nullptr;
+   }
+
+   Long64_t GetNChunks() const { return fNChunks; }
+   Long64_t GetMaxQueued() const { return fMaxQueued; }
+};
+
+#endif
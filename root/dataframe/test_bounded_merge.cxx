@@ -0,0 +1,149 @@
+// Peak RSS of per-slot result copies vs BoundedFill/BoundedTake.
+//
+//    bounded_merge [--entries=N] [--bins=N] [--max-slots=N] [--budget-mb=X]
+//
+// Fills a TH3D of --bins^3 bins (default 100^3, 8 MB) and takes a column of
+// 10% of the entries, with Histo3D and Take, which keep one copy per slot,
+// and with BoundedFill and BoundedTake under a --budget-mb budget (default
+// 4). Every configuration, for 1, 2, 4, ... --max-slots slots, runs in a
+// forked process, whose peak RSS is reported. Checks the results against
+// Count and Mean, and that with the bounded actions the peak RSS grows by
+// less than one histogram from 1 slot to --max-slots slots.
+
+#include "ROOT/RDataFrame.hxx"
+#include "TH3D.h"
+#include "TROOT.h"
+
+#include "BoundedMerge.h"
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+namespace {
+
+double Coordinate(ULong64_t e, ULong64_t k)
+{
+   return std::fmod((e + 1) * k * 0.6180339887, 1.);
+}
+
+// Returns 0 if the results are right.
+int Run(bool bounded, unsigned nSlots, ULong64_t entries, int bins, size_t budget)
+{
+#ifdef R__USE_IMT
+   if (nSlots > 1)
+      ROOT::EnableImplicitMT(nSlots);
+#endif
+   ROOT::RDataFrame d(entries);
+   auto df = d.Define("x", [](ULong64_t e) { return Coordinate(e, 1); }, {"rdfentry_"})
+                .Define("y", [](ULong64_t e) { return Coordinate(e, 7); }, {"rdfentry_"})
+                .Define("z", [](ULong64_t e) { return Coordinate(e, 13); }, {"rdfentry_"});
+   auto sel = df.Filter([](double y) { return y < 0.1; }, {"y"});
+   auto count = sel.Count();
+   auto mean = df.Mean<double>("x");
+   ROOT::RDF::RResultPtr<TH3D> h;
+   ROOT::RDF::RResultPtr<std::vector<double>> taken;
+   if (bounded) {
+      auto model = std::make_shared<TH3D>("h", "", bins, 0, 1, bins, 0, 1, bins, 0, 1);
+      h = df.Book<double, double, double>(BoundedFill<TH3D>(model, nSlots, budget), {"x", "y", "z"});
+      taken = sel.Book<double>(BoundedTake<double>(nSlots, budget), {"x"});
+   } else {
+      h = df.Histo3D<double, double, double>({"h", "", bins, 0, 1, bins, 0, 1, bins, 0, 1}, "x", "y", "z");
+      taken = sel.Take<double>("x");
+   }
+   int ret = 0;
+   if (h->GetEntries() != entries || std::abs(h->GetMean(1) - *mean) > 1e-9) {
+      fprintf(stderr, "Error: histogram has %g entries and mean %g, expected %llu and %g\n", h->GetEntries(),
+              h->GetMean(1), entries, *mean);
+      ret = 1;
+   }
+   if (taken->size() != *count) {
+      fprintf(stderr, "Error: took %zu values, expected %llu\n", taken->size(), *count);
+      ret = 1;
+   }
+   return ret;
+}
+
+// Runs a configuration in a child process. Returns its peak RSS in MB, or -1 on failure.
+double RunForked(bool bounded, unsigned nSlots, ULong64_t entries, int bins, size_t budget)
+{
+   fflush(stdout);
+   pid_t pid = fork();
+   if (pid == 0)
+      _exit(Run(bounded, nSlots, entries, bins, budget));
+   if (pid < 0)
+      return -1.;
+   int status;
+   struct rusage usage;
+   if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+      return -1.;
+#ifdef __APPLE__
+   return usage.ru_maxrss / 1024. / 1024.; // bytes
+#else
+   return usage.ru_maxrss / 1024.; // kB
+#endif
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+   ULong64_t entries = 4000000;
+   int bins = 100;
+   unsigned maxSlots = std::thread::hardware_concurrency();
+   double budgetMB = 4.;
+   for (int i = 1; i < argc; ++i) {
+      const char *arg = argv[i];
+      if (strncmp(arg, "--entries=", 10) == 0)
+         entries = atoll(arg + 10);
+      else if (strncmp(arg, "--bins=", 7) == 0)
+         bins = atoi(arg + 7);
+      else if (strncmp(arg, "--max-slots=", 12) == 0)
+         maxSlots = atoi(arg + 12);
+      else if (strncmp(arg, "--budget-mb=", 12) == 0)
+         budgetMB = atof(arg + 12);
+      else {
+         fprintf(stderr, "Usage: %s [--entries=N] [--bins=N] [--max-slots=N] [--budget-mb=X]\n", argv[0]);
+         return 2;
+      }
+   }
+#ifndef R__USE_IMT
+   maxSlots = 1;
+#endif
+   if (maxSlots < 1)
+      maxSlots = 1;
+   const size_t budget = budgetMB * 1024 * 1024;
+   const double histMB = (bins + 2.) * (bins + 2.) * (bins + 2.) * sizeof(double) / 1024. / 1024.;
+
+   printf("histogram %.1f MB, budget %.1f MB\n", histMB, budgetMB);
+   printf("%6s %16s %16s\n", "slots", "copies RSS (MB)", "bounded RSS (MB)");
+   int ret = 0;
+   double boundedFirst = 0., boundedLast = 0.;
+   for (unsigned nSlots = 1;; nSlots = std::min(2 * nSlots, maxSlots)) {
+      const double copies = RunForked(false, nSlots, entries, bins, budget);
+      const double bounded = RunForked(true, nSlots, entries, bins, budget);
+      printf("%6u %16.1f %16.1f\n", nSlots, copies, bounded);
+      if (copies < 0 || bounded < 0) {
+         fprintf(stderr, "Error: the run with %u slots failed\n", nSlots);
+         ret = 1;
+      }
+      if (nSlots == 1)
+         boundedFirst = bounded;
+      boundedLast = bounded;
+      if (nSlots == maxSlots)
+         break;
+   }
+   if (boundedLast - boundedFirst >= histMB) {
+      fprintf(stderr, "Error: bounded peak RSS grew by %.1f MB from 1 to %u slots\n", boundedLast - boundedFirst,
+              maxSlots);
+      ret = 1;
+   }
+   return ret;
+}
@@ -0,0 +1,199 @@
+// Events/s reading a flat ntuple entry by entry and a basket at a time.
+//
+//    bulk_read [--entries=N] [--branches=N] [--threads=N] [--keep]
+//
+// Writes bulk_read.root with --branches float branches (default 500) and a
+// fixed size array branch arr[8]/F, and sums all of them with
+//    TTreeReader     one TTreeReaderValue / TTreeReaderArray per branch
+//    bulk loop       TBranch::GetBulkRead() basket by basket, the upper bound
+//    RDF TTree       RDataFrame on the tree, one Sum per branch
+//    RDF BulkTreeDS  the same graph on BulkTreeDS
+// The RDataFrame graphs run on --threads threads. Reports events/s and the
+// uncompressed MB/s, and checks that all readers give the same sums.
+
+#include "ROOT/RDataFrame.hxx"
+#include "ROOT/RVec.hxx"
+#include "TBufferFile.h"
+#include "TBulkBranchRead.h"
+#include "TFile.h"
+#include "TROOT.h"
+#include "TSystem.h"
+#include "TTree.h"
+#include "TTreeReader.h"
+#include "TTreeReaderArray.h"
+#include "TTreeReaderValue.h"
+
+#include "BulkTreeDS.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+using ROOT::VecOps::RVec;
+
+const int kArrayLen = 8;
+
+std::string BranchName(int b)
+{
+   return "x" + std::to_string(b);
+}
+
+void WriteTree(const char *filename, Long64_t entries, int nbranches)
+{
+   TFile f(filename, "RECREATE");
+   TTree t("t", "flat ntuple");
+   std::vector<float> x(nbranches);
+   float arr[kArrayLen];
+   for (int b = 0; b < nbranches; ++b)
+      t.Branch(BranchName(b).c_str(), &x[b], (BranchName(b) + "/F").c_str());
+   t.Branch("arr", arr, ("arr[" + std::to_string(kArrayLen) + "]/F").c_str());
+   for (Long64_t e = 0; e < entries; ++e) {
+      for (int b = 0; b < nbranches; ++b)
+         x[b] = (e % 1000) * 0.001f + b;
+      for (int i = 0; i < kArrayLen; ++i)
+         arr[i] = (e % 100) * 0.01f - i;
+      t.Fill();
+   }
+   t.Write();
+}
+
+// Sums per branch, the array last.
+using Sums = std::vector<double>;
+
+Sums ReadTTreeReader(const char *filename, int nbranches)
+{
+   TFile f(filename);
+   TTreeReader reader("t", &f);
+   std::vector<std::unique_ptr<TTreeReaderValue<float>>> values;
+   for (int b = 0; b < nbranches; ++b)
+      values.emplace_back(new TTreeReaderValue<float>(reader, BranchName(b).c_str()));
+   TTreeReaderArray<float> arr(reader, "arr");
+   Sums sums(nbranches + 1);
+   while (reader.Next()) {
+      for (int b = 0; b < nbranches; ++b)
+         sums[b] += **values[b];
+      for (float a : arr)
+         sums[nbranches] += a;
+   }
+   return sums;
+}
+
+Sums ReadBulk(const char *filename, int nbranches)
+{
+   TFile f(filename);
+   TTree *t = f.Get<TTree>("t");
+   const Long64_t entries = t->GetEntries();
+   Sums sums(nbranches + 1);
+   TBufferFile buf(TBuffer::kWrite, 32 * 1024);
+   for (int b = 0; b <= nbranches; ++b) {
+      TBranch *branch = t->GetBranch(b < nbranches ? BranchName(b).c_str() : "arr");
+      const int len = b < nbranches ? 1 : kArrayLen;
+      for (Long64_t e = 0; e < entries;) {
+         const Int_t n = branch->GetBulkRead().GetBulkEntries(e, buf);
+         if (n <= 0)
+            return {};
+         const float *values = reinterpret_cast<const float *>(buf.GetCurrent());
+         double sum = 0.;
+         for (Long64_t i = 0; i < Long64_t(n) * len; ++i)
+            sum += values[i];
+         sums[b] += sum;
+         e += n;
+      }
+   }
+   return sums;
+}
+
+Sums ReadRDF(ROOT::RDataFrame &d, int nbranches)
+{
+   std::vector<ROOT::RDF::RResultPtr<double>> results;
+   for (int b = 0; b < nbranches; ++b)
+      results.push_back(d.Sum<float, double>(BranchName(b)));
+   results.push_back(d.Sum<RVec<float>, double>("arr"));
+   Sums sums;
+   for (auto &r : results)
+      sums.push_back(*r);
+   return sums;
+}
+
+bool Same(const Sums &a, const Sums &b)
+{
+   if (a.size() != b.size())
+      return false;
+   for (size_t i = 0; i < a.size(); ++i)
+      if (std::abs(a[i] - b[i]) > 1e-6 * (std::abs(b[i]) + 1.))
+         return false;
+   return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+   Long64_t entries = 100000;
+   int nbranches = 500;
+   unsigned nthreads = 1;
+   bool keep = false;
+   for (int i = 1; i < argc; ++i) {
+      const char *arg = argv[i];
+      if (strncmp(arg, "--entries=", 10) == 0)
+         entries = atoll(arg + 10);
+      else if (strncmp(arg, "--branches=", 11) == 0)
+         nbranches = atoi(arg + 11);
+      else if (strncmp(arg, "--threads=", 10) == 0)
+         nthreads = atoi(arg + 10);
+      else if (strcmp(arg, "--keep") == 0)
+         keep = true;
+      else {
+         fprintf(stderr, "Usage: %s [--entries=N] [--branches=N] [--threads=N] [--keep]\n", argv[0]);
+         return 2;
+      }
+   }
+#ifdef R__USE_IMT
+   if (nthreads != 1) {
+      ROOT::EnableImplicitMT(nthreads);
+      nthreads = ROOT::GetThreadPoolSize();
+   }
+#else
+   nthreads = 1;
+#endif
+
+   const char *filename = "bulk_read.root";
+   WriteTree(filename, entries, nbranches);
+   const double mb = 1e-6 * entries * (nbranches + kArrayLen) * sizeof(float);
+
+   printf("%-16s %8s %10s %12s %10s\n", "reader", "threads", "time (s)", "events/s", "MB/s");
+   const char *names[] = {"TTreeReader", "bulk loop", "RDF TTree", "RDF BulkTreeDS"};
+   Sums reference;
+   int ret = 0;
+   for (int mode = 0; mode < 4; ++mode) {
+      auto start = std::chrono::steady_clock::now();
+      Sums sums;
+      if (mode == 0) {
+         sums = ReadTTreeReader(filename, nbranches);
+      } else if (mode == 1) {
+         sums = ReadBulk(filename, nbranches);
+      } else {
+         ROOT::RDataFrame d = mode == 2 ? ROOT::RDataFrame("t", filename) : MakeBulkTreeDataFrame("t", filename);
+         sums = ReadRDF(d, nbranches);
+      }
+      const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      printf("%-16s %8u %10.3f %12.4g %10.1f\n", names[mode], mode < 2 ? 1 : nthreads, wall, entries / wall,
+             mb / wall);
+      if (mode == 0)
+         reference = sums;
+      else if (!Same(sums, reference)) {
+         fprintf(stderr, "Error: %s and TTreeReader give different sums\n", names[mode]);
+         ret = 1;
+      }
+   }
+   if (!keep)
+      gSystem->Unlink(filename);
+   return ret;
+}
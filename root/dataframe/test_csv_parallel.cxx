@@ -0,0 +1,147 @@
+// Throughput of RCsvDS and of ParallelCsvDS on a generated CSV file.
+//
+//    csv_parallel [--mb=N] [--threads=N] [--chunk-lines=N] [--keep]
+//
+// Writes csv_parallel.csv of about --mb MB (default 2048) with detector
+// condition like rows (run, event, a type string, four doubles, a charge and
+// a flag) and runs the same graph on it through FromCSV, which parses
+// --chunk-lines lines at a time in GetEntryRanges, and through
+// ParallelCsvDS. Reports rows/s and MB/s, and checks that both sources give
+// the same results. The file is removed unless --keep is given.
+
+#include "ROOT/RCsvDS.hxx"
+#include "ROOT/RDataFrame.hxx"
+#include "TROOT.h"
+#include "TSystem.h"
+
+#include "ParallelCsvDS.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+
+struct Results {
+   ULong64_t fRows = 0;
+   ULong64_t fTypeG = 0;
+   Long64_t fEventSum = 0;
+   double fESum = 0.;
+   double fMeanQ = 0.;
+   ULong64_t fFlagged = 0;
+};
+
+bool WriteCsv(const char *filename, double mb)
+{
+   FILE *out = fopen(filename, "w");
+   if (!out)
+      return false;
+   fprintf(out, "Run,Event,Type,E,px,py,pz,Q,Flag\n");
+   const double bytes = mb * 1e6;
+   double written = 0.;
+   char line[256];
+   unsigned long long seed = 42;
+   for (Long64_t event = 0; written < bytes; ++event) {
+      // xorshift, cheaper than TRandom for multi-GB files
+      seed ^= seed << 13;
+      seed ^= seed >> 7;
+      seed ^= seed << 17;
+      const double r = (seed >> 11) * (1. / 9007199254740992.);
+      const double px = 20. * r - 10., py = 10. - 20. * r * r, pz = 50. * (r - 0.5);
+      const double e = std::sqrt(px * px + py * py + pz * pz + 0.011);
+      int n = snprintf(line, sizeof(line), "%lld,%lld,%s,%.5f,%.5f,%.5f,%.5f,%d,%s\n", 146436 + event / 100000,
+                       event, seed % 3 ? "G" : "T", e, px, py, pz, seed & 4 ? 1 : -1, seed & 8 ? "true" : "false");
+      fwrite(line, 1, n, out);
+      written += n;
+   }
+   return fclose(out) == 0;
+}
+
+Results Run(ROOT::RDataFrame &d)
+{
+   auto rows = d.Count();
+   auto typeG = d.Filter([](const std::string &t) { return t == "G"; }, {"Type"}).Count();
+   auto eventSum = d.Sum<Long64_t>("Event");
+   auto eSum = d.Sum<double>("E");
+   auto meanQ = d.Mean<Long64_t>("Q");
+   auto flagged = d.Filter([](bool f) { return f; }, {"Flag"}).Count();
+   Results res;
+   res.fRows = *rows;
+   res.fTypeG = *typeG;
+   res.fEventSum = *eventSum;
+   res.fESum = *eSum;
+   res.fMeanQ = *meanQ;
+   res.fFlagged = *flagged;
+   return res;
+}
+
+bool Same(const Results &a, const Results &b)
+{
+   return a.fRows == b.fRows && a.fTypeG == b.fTypeG && a.fEventSum == b.fEventSum && a.fFlagged == b.fFlagged &&
+          std::abs(a.fESum - b.fESum) <= 1e-9 * std::abs(b.fESum) && std::abs(a.fMeanQ - b.fMeanQ) <= 1e-9;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+   double mb = 2048.;
+   unsigned nthreads = 0;
+   Long64_t chunkLines = 100000;
+   bool keep = false;
+   for (int i = 1; i < argc; ++i) {
+      const char *arg = argv[i];
+      if (strncmp(arg, "--mb=", 5) == 0)
+         mb = atof(arg + 5);
+      else if (strncmp(arg, "--threads=", 10) == 0)
+         nthreads = atoi(arg + 10);
+      else if (strncmp(arg, "--chunk-lines=", 14) == 0)
+         chunkLines = atoll(arg + 14);
+      else if (strcmp(arg, "--keep") == 0)
+         keep = true;
+      else {
+         fprintf(stderr, "Usage: %s [--mb=N] [--threads=N] [--chunk-lines=N] [--keep]\n", argv[0]);
+         return 2;
+      }
+   }
+#ifdef R__USE_IMT
+   ROOT::EnableImplicitMT(nthreads);
+   nthreads = ROOT::GetThreadPoolSize();
+#else
+   nthreads = 1;
+#endif
+
+   const char *filename = "csv_parallel.csv";
+   if (!WriteCsv(filename, mb)) {
+      fprintf(stderr, "Error: cannot write %s\n", filename);
+      return 1;
+   }
+   FileStat_t stat;
+   gSystem->GetPathInfo(filename, stat);
+   const double fileMB = 1e-6 * stat.fSize;
+
+   printf("%-14s %8s %10s %12s %10s\n", "source", "threads", "time (s)", "rows/s", "MB/s");
+   Results reference;
+   int ret = 0;
+   for (int parallel = 0; parallel < 2; ++parallel) {
+      auto start = std::chrono::steady_clock::now();
+      ROOT::RDataFrame d = parallel ? MakeParallelCsvDataFrame(filename) : ROOT::RDF::FromCSV(filename, true, ',', chunkLines);
+      Results res = Run(d);
+      const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      printf("%-14s %8u %10.3f %12.4g %10.1f\n", parallel ? "ParallelCsvDS" : "RCsvDS", nthreads, wall,
+             res.fRows / wall, fileMB / wall);
+      if (!parallel)
+         reference = res;
+      else if (!Same(res, reference)) {
+         fprintf(stderr, "Error: ParallelCsvDS and RCsvDS disagree: %llu rows vs %llu, E sum %.10g vs %.10g\n",
+                 res.fRows, reference.fRows, res.fESum, reference.fESum);
+         ret = 1;
+      }
+   }
+   if (!keep)
+      gSystem->Unlink(filename);
+   return ret;
+}
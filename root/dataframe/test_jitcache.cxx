@@ -0,0 +1,150 @@
+// Cold vs warm startup of a graph of string expressions with JitCache.
+//
+//    jitcache --mode=jit|cold|warm [--dir=jitcache]
+//
+// Builds and runs a graph of string Filters and Defines, with
+//    jit    the expressions jitted by RDataFrame, as in every job today
+//    cold   JitCache with an empty cache directory: the expressions are compiled
+//    warm   JitCache with the directory filled by a cold run: only loading
+// and checks the results against the same graph written with typed lambdas.
+// Prints the time from the start of main to the results and stores it in
+// jitcache_<mode>.time; the warm run compares with the other two and
+// requires that all expressions came from the cache.
+
+#include "ROOT/RDataFrame.hxx"
+#include "ROOT/RVec.hxx"
+#include "TSystem.h"
+
+#include "JitCache.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+namespace {
+
+using ROOT::VecOps::RVec;
+
+struct Results {
+   ULong64_t fCount = 0;
+   double fSumW = 0.;
+   double fSumN = 0.;
+};
+
+ROOT::RDF::RNode MakeSource(ROOT::RDataFrame &d)
+{
+   return d.Define("x", [](ULong64_t e) { return std::fmod(e * 0.618034, 1.); }, {"rdfentry_"})
+      .Define("y", [](ULong64_t e) { return int(e % 17); }, {"rdfentry_"})
+      .Define("v", [](ULong64_t e) { return RVec<float>(e % 5, 0.1f * (e % 7)); }, {"rdfentry_"});
+}
+
+Results Reference(ROOT::RDF::RNode n)
+{
+   auto sel = n.Filter([](double x, int y) { return x > 0.1 && y % 3 != 0; }, {"x", "y"})
+                 .Define("z", [](double x, int y, const RVec<float> &v) { return x * y + Sum(v); }, {"x", "y", "v"})
+                 .Define("w", [](double z, double x) { return std::sqrt(z) * std::cos(x); }, {"z", "x"})
+                 .Filter([](double z, double w) { return z > 10 || w < 0; }, {"z", "w"})
+                 .Define("n", [](const RVec<float> &v, int y) { return v.size() + y; }, {"v", "y"})
+                 .Filter([](const RVec<float> &v) { return v.size() > 0 && Max(v) > 0.2; }, {"v"});
+   auto count = sel.Count();
+   auto sumW = sel.Sum<double>("w");
+   auto sumN = sel.Sum<std::size_t>("n");
+   return {*count, *sumW, double(*sumN)};
+}
+
+const char *kFilter1 = "x > 0.1 && y % 3 != 0";
+const char *kZ = "x * y + Sum(v)";
+const char *kW = "sqrt(z) * cos(x)";
+const char *kFilter2 = "z > 10 || w < 0";
+const char *kN = "v.size() + y";
+const char *kFilter3 = "v.size() > 0 && Max(v) > 0.2";
+const int kNExpressions = 6;
+
+Results Run(ROOT::RDF::RNode n)
+{
+   auto count = n.Count();
+   // typed, to jit nothing but the expressions
+   auto sumW = n.Sum<double>("w");
+   auto sumN = n.Sum<std::size_t>("n");
+   return {*count, *sumW, double(*sumN)};
+}
+
+double ReadTime(const std::string &mode)
+{
+   std::ifstream in("jitcache_" + mode + ".time");
+   double t = -1.;
+   in >> t;
+   return t;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+   auto start = std::chrono::steady_clock::now();
+   std::string mode, dir = "jitcache";
+   for (int i = 1; i < argc; ++i) {
+      if (strncmp(argv[i], "--mode=", 7) == 0)
+         mode = argv[i] + 7;
+      else if (strncmp(argv[i], "--dir=", 6) == 0)
+         dir = argv[i] + 6;
+   }
+   if (mode != "jit" && mode != "cold" && mode != "warm") {
+      fprintf(stderr, "Usage: %s --mode=jit|cold|warm [--dir=jitcache]\n", argv[0]);
+      return 2;
+   }
+   if (mode == "cold")
+      gSystem->Exec(("rm -rf " + dir).c_str());
+
+   ROOT::RDataFrame d(10000);
+   ROOT::RDF::RNode src = MakeSource(d);
+   Results res;
+   int hits = 0, misses = 0;
+   if (mode == "jit") {
+      res = Run(src.Filter(kFilter1).Define("z", kZ).Define("w", kW).Filter(kFilter2).Define("n", kN).Filter(kFilter3));
+   } else {
+      JitCache cache(dir);
+      ROOT::RDF::RNode n = cache.Filter(src, kFilter1);
+      n = cache.Define(n, "z", kZ);
+      n = cache.Define(n, "w", kW);
+      n = cache.Filter(n, kFilter2);
+      n = cache.Define(n, "n", kN);
+      n = cache.Filter(n, kFilter3);
+      res = Run(n);
+      hits = cache.GetHits();
+      misses = cache.GetMisses();
+   }
+   const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+   int ret = 0;
+   Results ref = Reference(src);
+   if (res.fCount != ref.fCount || std::abs(res.fSumW - ref.fSumW) > 1e-9 * std::abs(ref.fSumW) ||
+       res.fSumN != ref.fSumN) {
+      fprintf(stderr, "Error: %s results differ: count %llu vs %llu, sum w %g vs %g, sum n %g vs %g\n", mode.c_str(),
+              res.fCount, ref.fCount, res.fSumW, ref.fSumW, res.fSumN, ref.fSumN);
+      ret = 1;
+   }
+   printf("%s: %.3f s to results, cache hits %d, misses %d\n", mode.c_str(), elapsed, hits, misses);
+   std::ofstream("jitcache_" + mode + ".time") << elapsed << std::endl;
+
+   if (mode == "cold" && misses != kNExpressions) {
+      fprintf(stderr, "Error: expected %d compiled expressions, got %d\n", kNExpressions, misses);
+      ret = 1;
+   }
+   if (mode == "warm") {
+      if (hits != kNExpressions || misses != 0) {
+         fprintf(stderr, "Error: expected %d cache hits and no miss, got %d and %d\n", kNExpressions, hits, misses);
+         ret = 1;
+      }
+      const double jit = ReadTime("jit"), cold = ReadTime("cold");
+      if (jit > 0)
+         printf("warm vs jit: %.2fx faster\n", jit / elapsed);
+      if (cold > 0)
+         printf("warm vs cold: %.2fx faster\n", cold / elapsed);
+   }
+   return ret;
+}
@@ -0,0 +1,79 @@
+// Per node profiling with NodeProfiler: graph, calls and passed entries of
+// Filters, Defines and actions, and the JSON export.
+#include "ROOT/RDataFrame.hxx"
+#include "TFile.h"
+#include "TROOT.h"
+#include "TTree.h"
+
+#include "NodeProfiler.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+void FillTree(const char *filename, const char *treeName)
+{
+   TFile f(filename, "RECREATE");
+   TTree t(treeName, treeName);
+   double b;
+   int n;
+   t.Branch("b", &b);
+   t.Branch("n", &n);
+   for (int i = 0; i < 100000; ++i) {
+      b = static_cast<double>(i) * 1.0e-5;
+      n = i % 10;
+      t.Fill();
+   }
+   t.Write();
+   f.Close();
+}
+
+int main()
+{
+   auto fileName = "test_node_profile.root";
+   auto treeName = "profileTree";
+   FillTree(fileName, treeName);
+
+#ifdef R__USE_IMT
+   ROOT::EnableImplicitMT(4);
+#endif
+   TFile file(fileName);
+   TTree *tree = nullptr;
+   file.GetObject(treeName, tree);
+   ROOT::RDataFrame df(*tree);
+
+   NodeProfiler prof(df.GetNSlots());
+   auto src = prof.Source(df, "profileTree", tree);
+   auto f1 = prof.Filter(src, "bCut", [](double b) { return b < 0.30005; }, {"b"});
+   auto d1 = prof.Define(f1, "b2", [](double b) { return b * b; }, {"b"});
+   auto f2 = prof.Filter(d1, "nCut", [](int n) { return n % 2 == 0; }, {"n"});
+   auto count = prof.Action(f2, "count")->Count();
+   auto d2 = prof.Define(src, "c", [](double b, int n) { return b + n; }, {"b", "n"});
+   auto sumC = prof.Action(d2, "sum_c")->Sum<double>("c");
+   auto sumB2 = prof.Action(d1, "sum_b2")->Sum<double>("b2");
+
+   std::cout << "count " << *count << "\n";
+   std::cout << "sum_c " << (*sumC > 0) << " sum_b2 " << (*sumB2 > 0) << "\n";
+   for (int id = 0; id < prof.GetNNodes(); ++id) {
+      const NodeProfiler::Node &node = prof.GetNode(id);
+      std::cout << node.fId << " parent " << node.fParent << " " << node.fKind << " " << node.fName << " calls "
+                << node.GetCalls() << " passed " << node.GetPassed() << " timed " << (node.GetSeconds() > 0)
+                << "\n";
+   }
+
+   // The JSON must hold one line per node, with its name and counts.
+   if (!prof.SaveJSON("test_node_profile.json"))
+      std::cerr << "Error: cannot write test_node_profile.json\n";
+   std::ifstream in("test_node_profile.json");
+   std::stringstream json;
+   json << in.rdbuf();
+   for (int id = 0; id < prof.GetNNodes(); ++id) {
+      const NodeProfiler::Node &node = prof.GetNode(id);
+      std::string expected = "\"name\": \"" + node.fName + "\"";
+      std::string calls = "\"calls\": " + std::to_string(node.GetCalls());
+      if (json.str().find(expected) == std::string::npos || json.str().find(calls) == std::string::npos)
+         std::cerr << "Error: node " << node.fName << " missing in the JSON export\n";
+   }
+   return 0;
+}
@@ -0,0 +1,278 @@
+// Strong scaling of the RDataFrame graph of test_par.cxx.
+//
+//    par_scaling [--entries=N] [--cluster=N] [--files=N] [--work=N]
+//                [--max-slots=N] [--trials=N] [--out=file.json]
+//
+// Generates --files trees with together --entries entries and clusters of
+// --cluster entries, then runs the same graph without IMT and with IMT on
+// 1, 2, 4, ... --max-slots slots (default: all cores). --work sets the number
+// of sin() evaluations per entry, i.e. the CPU cost of the analysis.
+//
+// For every slot count the best of --trials runs is reported:
+//    events/s      entries / wall time of the event loop
+//    efficiency    speedup over the run without IMT, divided by the slots
+//    busy, idle    per slot: time spent in tasks and the rest of the wall time
+// The difference between IMT on one slot and no IMT is the overhead of the
+// task arena. The results of every run are checked against the run without
+// IMT. With --out, the results are also written as JSON.
+
+#include "ROOT/RDataFrame.hxx"
+#include "TFile.h"
+#include "TROOT.h"
+#include "TTree.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock_t = std::chrono::steady_clock;
+
+struct Options {
+   Long64_t fEntries = 1000000;
+   Long64_t fCluster = 10000;
+   int fFiles = 1;
+   int fWork = 20;
+   int fMaxSlots = std::thread::hardware_concurrency();
+   int fTrials = 3;
+   std::string fOut;
+};
+
+// Per slot bookkeeping of the tasks, on its own cache line.
+struct alignas(64) SlotTiming {
+   ULong64_t fNextEntry = 0; // a task starts if the entry is not the next one
+   Clock_t::time_point fTaskStart;
+   Clock_t::time_point fLast;
+   double fBusy = 0.; // s, in finished tasks
+   Long64_t fEntries = 0;
+   int fTasks = 0;
+
+   void Entry(ULong64_t entry)
+   {
+      auto now = Clock_t::now();
+      if (fTasks == 0 || entry != fNextEntry) {
+         if (fTasks > 0)
+            fBusy += std::chrono::duration<double>(fLast - fTaskStart).count();
+         fTaskStart = now;
+         ++fTasks;
+      }
+      fLast = now;
+      fNextEntry = entry + 1;
+      ++fEntries;
+   }
+
+   double Busy() const { return fTasks ? fBusy + std::chrono::duration<double>(fLast - fTaskStart).count() : 0.; }
+};
+
+struct RunResult {
+   int fSlots = 0; // 0: no IMT
+   double fWall = 0.;
+   std::vector<double> fBusy;
+   std::vector<Long64_t> fSlotEntries;
+   std::vector<int> fSlotTasks;
+   ULong64_t fCount = 0;
+   int fMax = 0, fMin = 0;
+   double fMean = 0., fSum = 0.;
+   double fHistEntries = 0.;
+};
+
+std::vector<std::string> FillTrees(const Options &opts, const char *treeName)
+{
+   std::vector<std::string> files;
+   Long64_t first = 0;
+   for (int f = 0; f < opts.fFiles; ++f) {
+      Long64_t last = opts.fEntries * (f + 1) / opts.fFiles;
+      files.push_back("test_par_scaling_" + std::to_string(f) + ".root");
+      TFile file(files.back().c_str(), "RECREATE");
+      TTree t(treeName, treeName);
+      t.SetAutoFlush(opts.fCluster);
+      int i;
+      double x;
+      t.Branch("i", &i);
+      t.Branch("x", &x);
+      for (Long64_t entry = first; entry < last; ++entry) {
+         i = entry;
+         x = (entry % 1000) * 0.001;
+         t.Fill();
+      }
+      t.Write();
+      first = last;
+   }
+   return files;
+}
+
+RunResult RunGraph(const char *treeName, const std::vector<std::string> &files, int slots, int work)
+{
+   if (slots > 0)
+      ROOT::EnableImplicitMT(slots);
+   RunResult res;
+   res.fSlots = slots;
+   {
+      ROOT::RDataFrame d(treeName, files);
+      const unsigned nslots = d.GetNSlots();
+      std::vector<SlotTiming> timing(nslots);
+      auto timed = d.DefineSlotEntry("slotTiming_",
+                                     [&timing](unsigned slot, ULong64_t entry) {
+                                        timing[slot].Entry(entry);
+                                        return 0;
+                                     })
+                      .Filter([](int) { return true; }, {"slotTiming_"})
+                      .Define("w",
+                              [work](int i, double x) {
+                                 double r = x;
+                                 for (int k = 0; k < work; ++k)
+                                    r = std::sin(r) + 1e-9 * i;
+                                 return r;
+                              },
+                              {"i", "x"});
+      // the graph of test_par.cxx, plus a Sum over the per entry work
+      auto count = timed.Count();
+      auto max = timed.Filter([](int i) { return i % 2 == 1; }, {"i"}).Max<int>("i");
+      auto min = timed.Min<int>("i");
+      auto mean = timed.Mean<int>("i");
+      auto h = timed.Histo1D<int>("i");
+      auto sum = timed.Sum<double>("w");
+
+      auto start = Clock_t::now();
+      res.fCount = *count; // runs the event loop
+      res.fWall = std::chrono::duration<double>(Clock_t::now() - start).count();
+      res.fMax = *max;
+      res.fMin = *min;
+      res.fMean = *mean;
+      res.fSum = *sum;
+      res.fHistEntries = h->GetEntries();
+      for (const SlotTiming &t : timing) {
+         res.fBusy.push_back(t.Busy());
+         res.fSlotEntries.push_back(t.fEntries);
+         res.fSlotTasks.push_back(t.fTasks);
+      }
+   }
+   if (slots > 0)
+      ROOT::DisableImplicitMT();
+   return res;
+}
+
+bool SameResults(const RunResult &a, const RunResult &b)
+{
+   return a.fCount == b.fCount && a.fMax == b.fMax && a.fMin == b.fMin && a.fHistEntries == b.fHistEntries &&
+          std::abs(a.fMean - b.fMean) <= 1e-9 * std::abs(b.fMean) && std::abs(a.fSum - b.fSum) <= 1e-9 * std::abs(b.fSum);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+   Options opts;
+   for (int i = 1; i < argc; ++i) {
+      const char *arg = argv[i];
+      if (strncmp(arg, "--entries=", 10) == 0)
+         opts.fEntries = atoll(arg + 10);
+      else if (strncmp(arg, "--cluster=", 10) == 0)
+         opts.fCluster = atoll(arg + 10);
+      else if (strncmp(arg, "--files=", 8) == 0)
+         opts.fFiles = std::max(1, atoi(arg + 8));
+      else if (strncmp(arg, "--work=", 7) == 0)
+         opts.fWork = atoi(arg + 7);
+      else if (strncmp(arg, "--max-slots=", 12) == 0)
+         opts.fMaxSlots = atoi(arg + 12);
+      else if (strncmp(arg, "--trials=", 9) == 0)
+         opts.fTrials = std::max(1, atoi(arg + 9));
+      else if (strncmp(arg, "--out=", 6) == 0)
+         opts.fOut = arg + 6;
+      else {
+         fprintf(stderr,
+                 "Usage: %s [--entries=N] [--cluster=N] [--files=N] [--work=N] [--max-slots=N] [--trials=N] "
+                 "[--out=file.json]\n",
+                 argv[0]);
+         return 2;
+      }
+   }
+
+   const char *treeName = "myTree";
+   std::vector<std::string> files = FillTrees(opts, treeName);
+
+   std::vector<int> slotCounts = {0}; // no IMT
+#ifdef R__USE_IMT
+   for (int slots = 1; slots < opts.fMaxSlots; slots *= 2)
+      slotCounts.push_back(slots);
+   slotCounts.push_back(std::max(1, opts.fMaxSlots));
+#endif
+
+   std::vector<RunResult> best;
+   int ret = 0;
+   for (int slots : slotCounts) {
+      RunResult bestRun;
+      for (int trial = 0; trial < opts.fTrials; ++trial) {
+         RunResult run = RunGraph(treeName, files, slots, opts.fWork);
+         if (!best.empty() && !SameResults(run, best.front())) {
+            fprintf(stderr, "Error: results with %d slots differ from the run without IMT\n", slots);
+            ret = 1;
+         }
+         if (trial == 0 || run.fWall < bestRun.fWall)
+            bestRun = run;
+      }
+      best.push_back(bestRun);
+   }
+
+   const double serial = best.front().fWall;
+   printf("%6s %12s %10s %8s %10s %12s %12s %12s\n", "slots", "events/s", "speedup", "eff.", "tasks", "busy min(s)",
+          "busy max(s)", "idle sum(s)");
+   for (const RunResult &r : best) {
+      const int n = std::max(1, r.fSlots);
+      const double speedup = serial / r.fWall;
+      double busyMin = r.fBusy.empty() ? 0. : r.fBusy.front(), busyMax = 0., idle = 0.;
+      int tasks = 0;
+      for (size_t s = 0; s < r.fBusy.size(); ++s) {
+         busyMin = std::min(busyMin, r.fBusy[s]);
+         busyMax = std::max(busyMax, r.fBusy[s]);
+         idle += std::max(0., r.fWall - r.fBusy[s]);
+         tasks += r.fSlotTasks[s];
+      }
+      printf("%6s %12.4g %10.3f %8.3f %10d %12.4f %12.4f %12.4f\n",
+             r.fSlots ? std::to_string(r.fSlots).c_str() : "no IMT", opts.fEntries / r.fWall, speedup, speedup / n,
+             tasks, busyMin, busyMax, idle);
+   }
+   if (best.size() > 1)
+      printf("task arena overhead (IMT on 1 slot - no IMT): %.4f s\n", best[1].fWall - best[0].fWall);
+
+   if (!opts.fOut.empty()) {
+      FILE *out = fopen(opts.fOut.c_str(), "w");
+      if (!out) {
+         fprintf(stderr, "Error: cannot write %s\n", opts.fOut.c_str());
+         return 1;
+      }
+      fprintf(out, "{\n  \"entries\": %lld, \"cluster\": %lld, \"files\": %d, \"work\": %d, \"trials\": %d,\n",
+              opts.fEntries, opts.fCluster, opts.fFiles, opts.fWork, opts.fTrials);
+      fprintf(out, "  \"runs\": [\n");
+      for (size_t i = 0; i < best.size(); ++i) {
+         const RunResult &r = best[i];
+         const int n = std::max(1, r.fSlots);
+         fprintf(out, "    {\"slots\": %d, \"imt\": %s, \"wall_s\": %g, \"events_per_s\": %g, \"efficiency\": %g,\n",
+                 n, r.fSlots ? "true" : "false", r.fWall, opts.fEntries / r.fWall, serial / r.fWall / n);
+         fprintf(out, "     \"slot_busy_s\": [");
+         for (size_t s = 0; s < r.fBusy.size(); ++s)
+            fprintf(out, "%s%g", s ? ", " : "", r.fBusy[s]);
+         fprintf(out, "],\n     \"slot_idle_s\": [");
+         for (size_t s = 0; s < r.fBusy.size(); ++s)
+            fprintf(out, "%s%g", s ? ", " : "", std::max(0., r.fWall - r.fBusy[s]));
+         fprintf(out, "],\n     \"slot_entries\": [");
+         for (size_t s = 0; s < r.fSlotEntries.size(); ++s)
+            fprintf(out, "%s%lld", s ? ", " : "", r.fSlotEntries[s]);
+         fprintf(out, "],\n     \"slot_tasks\": [");
+         for (size_t s = 0; s < r.fSlotTasks.size(); ++s)
+            fprintf(out, "%s%d", s ? ", " : "", r.fSlotTasks[s]);
+         fprintf(out, "]}%s\n", i + 1 < best.size() ? "," : "");
+      }
+      fprintf(out, "  ],\n  \"task_arena_overhead_s\": %g\n}\n",
+              best.size() > 1 ? best[1].fWall - best[0].fWall : 0.);
+      fclose(out);
+   }
+   return ret;
+}
@@ -0,0 +1,159 @@
+// Throughput of Snapshot and of ParallelSnapshot (dedicated output thread).
+//
+//    snapshot_parallel [--entries=N] [--threads=N] [--cluster=N]
+//
+// Skims --entries generated entries (an int, a double and a vector<float>)
+// with a filter keeping 3/4 of them, once with Snapshot, which merges the
+// output of the slots through TBufferMerger, and once with ParallelSnapshot,
+// unordered and ordered. Reports events/s, output MB/s and the CPU
+// utilization (CPU time / (wall time * threads)), and checks that every mode
+// writes the same entries, in input order for the ordered mode.
+
+#include "ROOT/RDataFrame.hxx"
+#include "TFile.h"
+#include "TROOT.h"
+#include "TSystem.h"
+#include "TTree.h"
+
+#include "ParallelSnapshot.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace {
+
+double CpuSeconds()
+{
+   struct rusage usage;
+   getrusage(RUSAGE_SELF, &usage);
+   return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + 1e-6 * (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+ROOT::RDF::RNode MakeSkim(ROOT::RDataFrame &d)
+{
+   return d.Define("i", [](ULong64_t e) { return int(e); }, {"rdfentry_"})
+      .Define("x", [](int i) { return std::sin(i * 0.001); }, {"i"})
+      .Define("v",
+              [](int i) {
+                 std::vector<float> v(i % 8);
+                 for (size_t k = 0; k < v.size(); ++k)
+                    v[k] = 0.5f * k + i % 100;
+                 return v;
+              },
+              {"i"})
+      .Filter([](int i) { return i % 4 != 3; }, {"i"});
+}
+
+// Returns false if the file does not hold the skim of nentries entries.
+bool Check(const char *filename, Long64_t nentries, bool ordered)
+{
+   ROOT::RDataFrame d("t", filename);
+   auto is = d.Take<int>("i");
+   auto vsizes = d.Define("n", [](const std::vector<float> &v) { return int(v.size()); }, {"v"}).Sum<int>("n");
+   std::vector<int> values = *is;
+   if (ordered && !std::is_sorted(values.begin(), values.end())) {
+      fprintf(stderr, "Error: %s is not in input order\n", filename);
+      return false;
+   }
+   std::sort(values.begin(), values.end());
+   Long64_t expectedSizes = 0;
+   size_t k = 0;
+   for (Long64_t i = 0; i < nentries; ++i) {
+      if (i % 4 == 3)
+         continue;
+      if (k >= values.size() || values[k] != i) {
+         fprintf(stderr, "Error: entry %lld missing in %s\n", i, filename);
+         return false;
+      }
+      expectedSizes += i % 8;
+      ++k;
+   }
+   if (k != values.size() || *vsizes != expectedSizes) {
+      fprintf(stderr, "Error: unexpected content of %s\n", filename);
+      return false;
+   }
+   return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+   Long64_t nentries = 2000000;
+   unsigned nthreads = 4;
+   Long64_t cluster = 10000;
+   for (int i = 1; i < argc; ++i) {
+      const char *arg = argv[i];
+      if (strncmp(arg, "--entries=", 10) == 0)
+         nentries = atoll(arg + 10);
+      else if (strncmp(arg, "--threads=", 10) == 0)
+         nthreads = atoi(arg + 10);
+      else if (strncmp(arg, "--cluster=", 10) == 0)
+         cluster = atoll(arg + 10);
+      else {
+         fprintf(stderr, "Usage: %s [--entries=N] [--threads=N] [--cluster=N]\n", argv[0]);
+         return 2;
+      }
+   }
+#ifdef R__USE_IMT
+   ROOT::EnableImplicitMT(nthreads);
+   nthreads = ROOT::GetThreadPoolSize();
+#else
+   nthreads = 1;
+#endif
+
+   struct Mode {
+      const char *fName;
+      const char *fFile;
+      bool fOrdered;
+      std::function<void(ROOT::RDataFrame &, const char *)> fRun;
+   };
+   const std::vector<std::string> columns = {"i", "x", "v"};
+   const Mode modes[] = {
+      {"Snapshot", "snapshot_parallel_rdf.root", false,
+       [&](ROOT::RDataFrame &d, const char *file) {
+          ROOT::RDF::RSnapshotOptions opts;
+          opts.fAutoFlush = cluster;
+          MakeSkim(d).Snapshot<int, double, std::vector<float>>("t", file, columns, opts);
+       }},
+      {"ParallelSnapshot", "snapshot_parallel_unordered.root", false,
+       [&](ROOT::RDataFrame &d, const char *file) {
+          ParallelSnapshot snap("t", file, d.GetNSlots(), cluster);
+          snap.Run<int, double, std::vector<float>>(MakeSkim(d), columns);
+       }},
+      {"ParallelSnapshot ordered", "snapshot_parallel_ordered.root", true,
+       [&](ROOT::RDataFrame &d, const char *file) {
+          ParallelSnapshot snap("t", file, d.GetNSlots(), cluster, ROOT::RCompressionSetting::EDefaults::kUseGeneralPurpose,
+                                true);
+          snap.Run<int, double, std::vector<float>>(MakeSkim(d), columns);
+       }},
+   };
+
+   int ret = 0;
+   printf("%-26s %8s %12s %12s %10s\n", "mode", "threads", "events/s", "out MB/s", "CPU util.");
+   for (const Mode &mode : modes) {
+      ROOT::RDataFrame d(nentries);
+      const double cpuStart = CpuSeconds();
+      auto start = std::chrono::steady_clock::now();
+      mode.fRun(d, mode.fFile);
+      const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      const double cpu = CpuSeconds() - cpuStart;
+      FileStat_t stat;
+      const double mb = gSystem->GetPathInfo(mode.fFile, stat) == 0 ? 1e-6 * stat.fSize : 0.;
+      printf("%-26s %8u %12.4g %12.1f %10.2f\n", mode.fName, nthreads, nentries / wall, mb / wall,
+             cpu / (wall * nthreads));
+      if (!Check(mode.fFile, nentries, mode.fOrdered))
+         ret = 1;
+      gSystem->Unlink(mode.fFile);
+   }
+   return ret;
+}
@@ -0,0 +1,303 @@
+// Compression benchmark with the Event model of MainEvent.cxx.
+//
+//    codecBench [--events=N] [--tracks=N] [--trials=N]
+//               [--settings=101,106,...] [--splits=0,1,99] [--output=file]
+//
+// For every compression setting (algorithm * 100 + level, as for
+// TFile::SetCompressionSettings) and split level, writes the Event tree of
+// MainEvent.cxx into codecBench_<setting>_<split>.root and reads it back,
+// each in a forked process so that the peak RSS of the write and of the read
+// can be measured separately. Reports the compression ratio (uncompressed /
+// compressed tree size), write and read MB/s (uncompressed MB over the time
+// spent in TTree::Fill, TFile::Write and TTree::GetEntry, i.e. without the
+// creation of the events) and the peak RSS. The results are printed and
+// stored in the TTree "results" of --output (default codecBench.root); the
+// TTree "branches" holds the per branch sizes, to compare codecs per branch.
+
+#include "TBranch.h"
+#include "TFile.h"
+#include "TObjArray.h"
+#include "TRandom.h"
+#include "TROOT.h"
+#include "TSystem.h"
+#include "TTree.h"
+
+#include "Event.h"
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Sent by the child process through a pipe.
+struct PhaseResult {
+   Int_t fStatus = 1; // 0 on success
+   Double_t fSeconds = 0.;
+   Long64_t fTotBytes = 0;
+   Long64_t fZipBytes = 0;
+};
+
+std::string FileName(int setting, int split)
+{
+   return "codecBench_" + std::to_string(setting) + "_" + std::to_string(split) + ".root";
+}
+
+PhaseResult WriteEvents(const std::string &filename, int setting, int split, int nevent, int ntracks)
+{
+   // As the write case of MainEvent.cxx, timing only Fill and Write.
+   PhaseResult result;
+   gRandom->SetSeed(42);
+   TFile hfile(filename.c_str(), "RECREATE", "codecBench", setting);
+   if (hfile.IsZombie())
+      return result;
+   TTree *tree = new TTree("T", "An example of a ROOT tree");
+   tree->SetAutoSave(1000000000);
+   Int_t bufsize = split ? 64000 / 4 : 64000;
+   Event *event = new Event();
+   TBranch *branch = tree->Bronch("event", "Event", &event, bufsize, split);
+   branch->SetAutoDelete(kFALSE);
+   char etype[20];
+   std::chrono::duration<double> elapsed(0);
+   for (Int_t ev = 0; ev < nevent; ev++) {
+      Float_t sigmat, sigmas;
+      gRandom->Rannor(sigmat, sigmas);
+      Int_t ntrack = Int_t(ntracks + ntracks * sigmat / 120.);
+      Float_t random = gRandom->Rndm(1);
+      snprintf(etype, 20, "type%d", ev % 5);
+      event->SetType(etype);
+      event->SetHeader(ev, 200, 960312, random);
+      event->SetNseg(Int_t(10 * ntrack + 20 * sigmas));
+      event->SetNvertex(Int_t(1 + 20 * gRandom->Rndm()));
+      event->SetFlag(UInt_t(random + 0.5));
+      event->SetTemperature(random + 20.);
+      for (UChar_t m = 0; m < 10; m++)
+         event->SetMeasure(m, Int_t(gRandom->Gaus(m, m + 1)));
+      for (UChar_t i0 = 0; i0 < 4; i0++)
+         for (UChar_t i1 = 0; i1 < 4; i1++)
+            event->SetMatrix(i0, i1, gRandom->Gaus(i0 * i1, 1));
+      event->GetUshort()->push_back(3);
+      event->GetUshort()->push_back(5);
+      for (Int_t t = 0; t < ntrack; t++)
+         event->AddTrack(random);
+
+      auto start = std::chrono::steady_clock::now();
+      tree->Fill();
+      elapsed += std::chrono::steady_clock::now() - start;
+      event->Clear();
+   }
+   auto start = std::chrono::steady_clock::now();
+   hfile.Write();
+   elapsed += std::chrono::steady_clock::now() - start;
+
+   result.fSeconds = elapsed.count();
+   result.fTotBytes = tree->GetTotBytes();
+   result.fZipBytes = tree->GetZipBytes();
+   result.fStatus = 0;
+   return result;
+}
+
+PhaseResult ReadEvents(const std::string &filename, int nevent)
+{
+   PhaseResult result;
+   TFile hfile(filename.c_str());
+   TTree *tree = nullptr;
+   hfile.GetObject("T", tree);
+   if (!tree || tree->GetEntries() != nevent)
+      return result;
+   Event *event = nullptr;
+   tree->SetBranchAddress("event", &event);
+   auto start = std::chrono::steady_clock::now();
+   for (Long64_t ev = 0; ev < nevent; ev++) {
+      tree->GetEntry(ev);
+      if (event->GetTemperature() < 20.0 || event->GetTemperature() > 21.0)
+         return result; // as in MainEvent.cxx
+   }
+   result.fSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   result.fTotBytes = tree->GetTotBytes();
+   result.fZipBytes = tree->GetZipBytes();
+   result.fStatus = 0;
+   return result;
+}
+
+// Runs phase in a child process. Sets peakRSS to its peak RSS in MB.
+template <typename Phase>
+PhaseResult RunForked(Phase phase, double &peakRSS)
+{
+   PhaseResult result;
+   int fds[2];
+   if (pipe(fds) != 0)
+      return result;
+   fflush(stdout);
+   pid_t pid = fork();
+   if (pid == 0) {
+      close(fds[0]);
+      PhaseResult child = phase();
+      bool ok = write(fds[1], &child, sizeof(child)) == sizeof(child);
+      _exit(ok ? 0 : 1);
+   }
+   close(fds[1]);
+   if (pid < 0) {
+      close(fds[0]);
+      return result;
+   }
+   if (read(fds[0], &result, sizeof(result)) != sizeof(result))
+      result.fStatus = 1;
+   close(fds[0]);
+   int status;
+   struct rusage usage;
+   if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+      result.fStatus = 1;
+#ifdef __APPLE__
+   peakRSS = usage.ru_maxrss / 1024. / 1024.; // bytes
+#else
+   peakRSS = usage.ru_maxrss / 1024.; // kB
+#endif
+   return result;
+}
+
+std::vector<int> ParseList(const char *list)
+{
+   std::vector<int> values;
+   std::stringstream stream(list);
+   std::string item;
+   while (std::getline(stream, item, ','))
+      values.push_back(atoi(item.c_str()));
+   return values;
+}
+
+void FillBranchSizes(TObjArray *branches, TTree &out, std::string &name, Long64_t &totBytes, Long64_t &zipBytes)
+{
+   for (Int_t i = 0; i < branches->GetEntriesFast(); ++i) {
+      auto branch = static_cast<TBranch *>(branches->UncheckedAt(i));
+      name = branch->GetName();
+      totBytes = branch->GetTotBytes();
+      zipBytes = branch->GetZipBytes();
+      out.Fill();
+      FillBranchSizes(branch->GetListOfBranches(), out, name, totBytes, zipBytes);
+   }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+   TROOT codecBench("codecBench", "Compression benchmark");
+   int nevent = 400;
+   int ntracks = 600;
+   int ntrials = 1;
+   // ZLIB, LZMA, LZ4, ZSTD at a low, the default and a high level.
+   std::vector<int> settings = {0, 101, 106, 109, 201, 205, 209, 401, 404, 409, 501, 505, 509};
+   std::vector<int> splits = {0, 1, 99};
+   std::string output = "codecBench.root";
+   for (int i = 1; i < argc; ++i) {
+      const char *arg = argv[i];
+      if (strncmp(arg, "--events=", 9) == 0)
+         nevent = atoi(arg + 9);
+      else if (strncmp(arg, "--tracks=", 9) == 0)
+         ntracks = atoi(arg + 9);
+      else if (strncmp(arg, "--trials=", 9) == 0)
+         ntrials = atoi(arg + 9);
+      else if (strncmp(arg, "--settings=", 11) == 0)
+         settings = ParseList(arg + 11);
+      else if (strncmp(arg, "--splits=", 9) == 0)
+         splits = ParseList(arg + 9);
+      else if (strncmp(arg, "--output=", 9) == 0)
+         output = arg + 9;
+      else {
+         fprintf(stderr,
+                 "Usage: %s [--events=N] [--tracks=N] [--trials=N] [--settings=101,106,...] [--splits=0,1,99] "
+                 "[--output=file]\n",
+                 argv[0]);
+         return 2;
+      }
+   }
+   Track::Class()->IgnoreTObjectStreamer();
+
+   TFile outfile(output.c_str(), "RECREATE");
+   TTree *results = new TTree("results", "codecBench results"); // owned by outfile
+   Int_t setting, algorithm, level, split, trial;
+   Long64_t totBytes, zipBytes;
+   Double_t ratio, writeMBs, readMBs, writeRSS, readRSS;
+   results->Branch("setting", &setting);
+   results->Branch("algorithm", &algorithm);
+   results->Branch("level", &level);
+   results->Branch("split", &split);
+   results->Branch("trial", &trial);
+   results->Branch("events", &nevent);
+   results->Branch("totBytes", &totBytes);
+   results->Branch("zipBytes", &zipBytes);
+   results->Branch("ratio", &ratio);
+   results->Branch("writeMBs", &writeMBs);
+   results->Branch("readMBs", &readMBs);
+   results->Branch("writePeakRSS", &writeRSS); // MB
+   results->Branch("readPeakRSS", &readRSS);   // MB
+   TTree *branches = new TTree("branches", "codecBench per branch sizes");
+   std::string branchName;
+   branches->Branch("setting", &setting);
+   branches->Branch("split", &split);
+   branches->Branch("name", &branchName);
+   branches->Branch("totBytes", &totBytes);
+   branches->Branch("zipBytes", &zipBytes);
+
+   printf("%8s %5s %5s %12s %12s %8s %10s %10s %10s %10s\n", "setting", "split", "trial", "tot bytes", "zip bytes",
+          "ratio", "write MB/s", "read MB/s", "wRSS (MB)", "rRSS (MB)");
+   int ret = 0;
+   for (int s : settings) {
+      for (int sp : splits) {
+         setting = s;
+         algorithm = s / 100;
+         level = s % 100;
+         split = sp;
+         const std::string filename = FileName(setting, split);
+         bool failed = false;
+         for (trial = 0; trial < ntrials; ++trial) {
+            PhaseResult w = RunForked([&] { return WriteEvents(filename, setting, split, nevent, ntracks); }, writeRSS);
+            PhaseResult r = RunForked([&] { return ReadEvents(filename, nevent); }, readRSS);
+            if (w.fStatus || r.fStatus) {
+               fprintf(stderr, "codecBench: %s failed for setting %d split %d\n", w.fStatus ? "writing" : "reading",
+                       setting, split);
+               failed = true;
+               break;
+            }
+            totBytes = w.fTotBytes;
+            zipBytes = w.fZipBytes;
+            ratio = zipBytes > 0 ? double(totBytes) / zipBytes : 0.;
+            writeMBs = w.fSeconds > 0 ? 1e-6 * totBytes / w.fSeconds : 0.;
+            readMBs = r.fSeconds > 0 ? 1e-6 * r.fTotBytes / r.fSeconds : 0.;
+            printf("%8d %5d %5d %12lld %12lld %8.3f %10.1f %10.1f %10.1f %10.1f\n", setting, split, trial, totBytes,
+                   zipBytes, ratio, writeMBs, readMBs, writeRSS, readRSS);
+            outfile.cd();
+            results->Fill();
+         }
+         if (failed) {
+            ret = 1;
+            gSystem->Unlink(filename.c_str());
+            continue;
+         }
+         // The per branch sizes do not change between trials.
+         TFile infile(filename.c_str());
+         TTree *tree = nullptr;
+         infile.GetObject("T", tree);
+         if (tree) {
+            outfile.cd();
+            FillBranchSizes(tree->GetListOfBranches(), *branches, branchName, totBytes, zipBytes);
+         }
+         infile.Close();
+         gSystem->Unlink(filename.c_str());
+      }
+   }
+   outfile.cd();
+   results->Write();
+   branches->Write();
+   outfile.Close();
+   return ret;
+}
@@ -0,0 +1,147 @@
+// Microbenchmarks of object streaming through TBufferFile and TTree.
+//
+// Extends ReadBuffer.C / WriteBuffer.C (fixed-size structs) with STL members,
+// Double32_t / Float16_t, and member-wise vs object-wise streaming of a
+// vector of classes (see simple/vectorMWclass.C), both into a bare buffer and
+// into split and unsplit branches. Reports bytes/s and ns per object; see
+// scripts/pt_bench.h for the options, e.g. --benchmark_out=<file>.
+
+#include "TBufferFile.h"
+#include "TClass.h"
+#include "TTree.h"
+#include "TVirtualStreamerInfo.h"
+
+#include "bufferBenchClasses.h"
+#include "scripts/pt_bench.h"
+
+#include <string>
+
+// Stream proto into a buffer (Write/<name>) and back (Read/<name>). nitems is
+// the number of objects contained in proto. If memberwise is 0 or 1,
+// collections are streamed object-wise or member-wise.
+template <typename T>
+void AddStreamerBenchmarks(PTBench::Runner &runner, const std::string &name, T &proto, long nitems = 1,
+                           int memberwise = -1)
+{
+   runner.Add("Write/" + name, [&proto, nitems, memberwise](PTBench::State &state) {
+      if (memberwise >= 0)
+         TVirtualStreamerInfo::SetStreamMemberWise(memberwise);
+      TClass *cl = TClass::GetClass(typeid(T));
+      TBufferFile buf(TBuffer::kWrite, 32000);
+      while (state.KeepRunning()) {
+         buf.Reset();
+         cl->Streamer(&proto, buf);
+      }
+      state.SetBytesProcessed(double(state.iterations()) * buf.Length());
+      state.SetItemsProcessed(double(state.iterations()) * nitems);
+   });
+
+   runner.Add("Read/" + name, [&proto, nitems, memberwise](PTBench::State &state) {
+      if (memberwise >= 0)
+         TVirtualStreamerInfo::SetStreamMemberWise(memberwise);
+      TClass *cl = TClass::GetClass(typeid(T));
+      TBufferFile buf(TBuffer::kWrite, 32000);
+      cl->Streamer(&proto, buf);
+      Int_t length = buf.Length();
+      buf.SetReadMode();
+      T obj;
+      while (state.KeepRunning()) {
+         buf.Reset();
+         cl->Streamer(&obj, buf);
+      }
+      if (buf.Length() != length)
+         state.SkipWithError("read " + std::to_string(buf.Length()) + " bytes, wrote " + std::to_string(length));
+      state.SetBytesProcessed(double(state.iterations()) * length);
+      state.SetItemsProcessed(double(state.iterations()) * nitems);
+   });
+}
+
+// Fill proto into a memory resident branch with the given split level
+// (TreeFill/<name>/split<N>) and read it back (TreeRead/<name>/split<N>).
+template <typename T>
+void AddTreeBenchmarks(PTBench::Runner &runner, const std::string &name, T &proto, int split, long nitems = 1)
+{
+   const std::string suffix = name + "/split" + std::to_string(split);
+   const Long64_t kEntries = 1000;
+
+   runner.Add("TreeFill/" + suffix, [&proto, split, nitems, kEntries](PTBench::State &state) {
+      TTree tree("t", "t");
+      tree.SetDirectory(nullptr);
+      tree.SetCircular(kEntries); // bounds the memory, not the work per Fill
+      T *ptr = &proto;
+      tree.Branch("obj", &ptr, 32000, split);
+      double bytes = 0.;
+      while (state.KeepRunning())
+         bytes += tree.Fill();
+      state.SetBytesProcessed(bytes);
+      state.SetItemsProcessed(double(state.iterations()) * nitems);
+   });
+
+   runner.Add("TreeRead/" + suffix, [&proto, split, nitems, kEntries](PTBench::State &state) {
+      TTree tree("t", "t");
+      tree.SetDirectory(nullptr);
+      T *ptr = &proto;
+      tree.Branch("obj", &ptr, 32000, split);
+      for (Long64_t i = 0; i < kEntries; ++i)
+         tree.Fill();
+      T *obj = new T;
+      tree.SetBranchAddress("obj", &obj);
+      double bytes = 0.;
+      Long64_t entry = 0;
+      while (state.KeepRunning()) {
+         bytes += tree.GetEntry(entry);
+         if (++entry == kEntries)
+            entry = 0;
+      }
+      tree.ResetBranchAddresses();
+      delete obj;
+      state.SetBytesProcessed(bytes);
+      state.SetItemsProcessed(double(state.iterations()) * nitems);
+   });
+}
+
+int main(int argc, char **argv)
+{
+   PTBench::Runner runner(argc, argv);
+
+   const int kNumElements = 600; // as in simple/vectorMWclass.C
+
+   BenchAllInt allint;
+   BenchFltInt fltint;
+   BenchStl stl;
+   stl.Fill(kNumElements);
+   BenchDouble dbl;
+   BenchDouble32 d32;
+   BenchDouble32Range d32range;
+   BenchFloat16 f16;
+   BenchHolderMW holderMW;
+   holderMW.Fill(kNumElements);
+   BenchHolderOW holderOW;
+   holderOW.Fill(kNumElements);
+
+   // Build the streamer infos of the holders in their mode.
+   TVirtualStreamerInfo::SetStreamMemberWise(kTRUE);
+   TClass::GetClass(typeid(BenchHolderMW))->GetStreamerInfo();
+   TVirtualStreamerInfo::SetStreamMemberWise(kFALSE);
+   TClass::GetClass(typeid(BenchHolderOW))->GetStreamerInfo();
+   TVirtualStreamerInfo::SetStreamMemberWise(kTRUE);
+
+   AddStreamerBenchmarks(runner, "allint", allint);
+   AddStreamerBenchmarks(runner, "fltint", fltint);
+   AddStreamerBenchmarks(runner, "stl", stl, 3 * kNumElements);
+   AddStreamerBenchmarks(runner, "double", dbl, 16);
+   AddStreamerBenchmarks(runner, "Double32", d32, 16);
+   AddStreamerBenchmarks(runner, "Double32Range", d32range, 16);
+   AddStreamerBenchmarks(runner, "Float16", f16, 16);
+   AddStreamerBenchmarks(runner, "vectorMW", holderMW, kNumElements, 1);
+   AddStreamerBenchmarks(runner, "vectorOW", holderOW, kNumElements, 0);
+
+   for (int split : {0, 99}) {
+      AddTreeBenchmarks(runner, "allint", allint, split);
+      AddTreeBenchmarks(runner, "stl", stl, split, 3 * kNumElements);
+      AddTreeBenchmarks(runner, "vectorMW", holderMW, split, kNumElements);
+      AddTreeBenchmarks(runner, "vectorOW", holderOW, split, kNumElements);
+   }
+
+   return runner.Run();
+}
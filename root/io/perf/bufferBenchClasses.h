@@ -0,0 +1,133 @@
+#ifndef ROOTTEST_BUFFERBENCHCLASSES_H
+#define ROOTTEST_BUFFERBENCHCLASSES_H
+
+// Classes streamed by bufferBench.cxx. BenchAllInt and BenchFltInt are the
+// allint / fltint of ReadBuffer.C and WriteBuffer.C; BenchHit is the
+// "simple" class of the simple/ macros.
+
+#include "Rtypes.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+class BenchAllInt {
+public:
+   int a1;
+   int a2;
+   int a3;
+   int a4;
+   int a5;
+   int a6;
+   int a7;
+   int a8;
+   int a9;
+   BenchAllInt() : a1(0),a2(0),a3(0),a4(0),a5(0),a6(0),a7(0),a8(0),a9(0) {}
+};
+
+class BenchFltInt {
+public:
+   int a1;
+   float a2;
+   int a3;
+   float a4;
+   int a5;
+   float a6;
+   int a7;
+   float a8;
+   int a9;
+   BenchFltInt() : a1(0),a2(0),a3(0),a4(0),a5(0),a6(0),a7(0),a8(0),a9(0) {}
+};
+
+class BenchStl {
+public:
+   std::vector<float> fFloats;
+   std::vector<int> fInts;
+   std::string fName;
+   std::map<int, float> fMap;
+   void Fill(int n) {
+      fName = "BenchStl with some payload";
+      for (int i = 0; i < n; ++i) {
+         fFloats.push_back(i / 3.f);
+         fInts.push_back(i);
+         fMap[i] = i / 7.f;
+      }
+   }
+};
+
+// The same values as double, Double32_t without and with range, Float16_t.
+class BenchDouble {
+public:
+   double fValues[16];
+   BenchDouble() { for (int i = 0; i < 16; ++i) fValues[i] = i / 3.; }
+};
+
+class BenchDouble32 {
+public:
+   Double32_t fValues[16];
+   BenchDouble32() { for (int i = 0; i < 16; ++i) fValues[i] = i / 3.; }
+};
+
+class BenchDouble32Range {
+public:
+   Double32_t fValues[16]; //[0,16,20]
+   BenchDouble32Range() { for (int i = 0; i < 16; ++i) fValues[i] = i / 3.; }
+};
+
+class BenchFloat16 {
+public:
+   Float16_t fValues[16]; //[0,16,12]
+   BenchFloat16() { for (int i = 0; i < 16; ++i) fValues[i] = i / 3.; }
+};
+
+#define var(x) int i##x; float f##x
+#define udef(x) i##x(0),f##x(0.0)
+#define def(x) i##x(x),f##x(x/3.0)
+
+class BenchHit {
+private:
+   var(0);
+   var(1);
+   var(2);
+   var(3);
+   var(4);
+   var(5);
+   var(6);
+   var(7);
+   var(8);
+   var(9);
+
+public:
+   BenchHit() :
+      udef(0),udef(1),udef(2),udef(3),udef(4),udef(5),udef(6),
+      udef(7),udef(8),udef(9)
+   {}
+   BenchHit(int) :
+      def(0),def(1),def(2),def(3),def(4),def(5),def(6),
+      def(7),def(8),def(9)
+   {}
+
+   ClassDef(BenchHit,2);
+};
+
+#undef var
+#undef udef
+#undef def
+
+// Two identical holders, so that one can be streamed member-wise and the
+// other object-wise within the same process.
+class BenchHolderMW {
+public:
+   std::vector<BenchHit> fHits;
+   void Fill(int n) { for (int i = 0; i < n; ++i) fHits.push_back(BenchHit(i)); }
+   ClassDef(BenchHolderMW,2);
+};
+
+class BenchHolderOW {
+public:
+   std::vector<BenchHit> fHits;
+   void Fill(int n) { for (int i = 0; i < n; ++i) fHits.push_back(BenchHit(i)); }
+   ClassDef(BenchHolderOW,2);
+};
+
+#endif
@@ -0,0 +1,13 @@
+#ifdef __CLING__
+#pragma link C++ class BenchAllInt+;
+#pragma link C++ class BenchFltInt+;
+#pragma link C++ class BenchStl+;
+#pragma link C++ class BenchDouble+;
+#pragma link C++ class BenchDouble32+;
+#pragma link C++ class BenchDouble32Range+;
+#pragma link C++ class BenchFloat16+;
+#pragma link C++ class BenchHit+;
+#pragma link C++ class std::vector<BenchHit>+;
+#pragma link C++ class BenchHolderMW+;
+#pragma link C++ class BenchHolderOW+;
+#endif
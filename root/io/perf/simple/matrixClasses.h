@@ -0,0 +1,100 @@
+#ifndef ROOTTEST_MATRIXCLASSES_H
+#define ROOTTEST_MATRIXCLASSES_H
+
+// Element and holder classes of streamingMatrix.cxx. MatrixObj and
+// MatrixTObj are the "simple" classes of the *class.C and *tclass.C macros.
+
+#include "TNamed.h"
+
+#include <list>
+#include <set>
+#include <vector>
+
+#define var(x) int i##x; float f##x
+#define udef(x) i##x(0),f##x(0.0)
+#define def(x) i##x(x),f##x(x/3.0)
+
+class MatrixObj {
+private:
+   var(0);
+   var(1);
+   var(2);
+   var(3);
+   var(4);
+   var(5);
+   var(6);
+   var(7);
+   var(8);
+   var(9);
+
+public:
+   MatrixObj() :
+      udef(0),udef(1),udef(2),udef(3),udef(4),udef(5),udef(6),
+      udef(7),udef(8),udef(9)
+   {}
+   MatrixObj(int) :
+      def(0),def(1),def(2),def(3),def(4),def(5),def(6),
+      def(7),def(8),def(9)
+   {}
+   bool operator<(const MatrixObj &s) const { return i0 < s.i0; }
+
+   ClassDef(MatrixObj,2);
+};
+
+class MatrixTObj : public TNamed {
+private:
+   var(0);
+   var(1);
+   var(2);
+   var(3);
+   var(4);
+   var(5);
+   var(6);
+   var(7);
+   var(8);
+   var(9);
+
+public:
+   MatrixTObj() :
+      udef(0),udef(1),udef(2),udef(3),udef(4),udef(5),udef(6),
+      udef(7),udef(8),udef(9)
+   {}
+   MatrixTObj(int) :
+      def(0),def(1),def(2),def(3),def(4),def(5),def(6),
+      def(7),def(8),def(9)
+   {}
+   bool operator<(const MatrixTObj &s) const { return i0 < s.i0; }
+
+   ClassDef(MatrixTObj,2);
+};
+
+#undef var
+#undef udef
+#undef def
+
+// Holders own the pointees of pointer containers.
+template <typename T>
+inline void MatrixDeleteElement(const T &) {}
+inline void MatrixDeleteElement(MatrixTObj *ptr) { delete ptr; }
+
+// Tag distinguishes otherwise identical holders: streamer infos are built
+// once per class, so member-wise (Tag 1) and object-wise (Tag 0) streaming
+// need different classes within one process.
+template <typename Container, int Tag>
+class MatrixHolder {
+public:
+   Container fContainer;
+
+   MatrixHolder() {}
+   virtual ~MatrixHolder() { Reset(); }
+
+   void Reset() {
+      for (auto &elem : fContainer)
+         MatrixDeleteElement(elem);
+      fContainer.clear();
+   }
+
+   ClassDef(MatrixHolder,1);
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifdef __CLING__
+#pragma link C++ class MatrixObj+;
+#pragma link C++ class MatrixTObj+;
+#pragma link C++ class std::vector<MatrixObj>+;
+#pragma link C++ class std::vector<MatrixTObj>+;
+#pragma link C++ class std::vector<MatrixTObj*>+;
+#pragma link C++ class std::list<MatrixObj>+;
+#pragma link C++ class std::list<MatrixTObj>+;
+#pragma link C++ class std::list<MatrixTObj*>+;
+#pragma link C++ class std::set<MatrixObj>+;
+#pragma link C++ class std::set<MatrixTObj>+;
+#pragma link C++ class std::set<MatrixTObj*>+;
+#pragma link C++ class MatrixHolder<std::vector<int>,0>+;
+#pragma link C++ class MatrixHolder<std::vector<MatrixObj>,0>+;
+#pragma link C++ class MatrixHolder<std::vector<MatrixObj>,1>+;
+#pragma link C++ class MatrixHolder<std::vector<MatrixTObj>,0>+;
+#pragma link C++ class MatrixHolder<std::vector<MatrixTObj>,1>+;
+#pragma link C++ class MatrixHolder<std::vector<MatrixTObj*>,0>+;
+#pragma link C++ class MatrixHolder<std::list<int>,0>+;
+#pragma link C++ class MatrixHolder<std::list<MatrixObj>,0>+;
+#pragma link C++ class MatrixHolder<std::list<MatrixObj>,1>+;
+#pragma link C++ class MatrixHolder<std::list<MatrixTObj>,0>+;
+#pragma link C++ class MatrixHolder<std::list<MatrixTObj>,1>+;
+#pragma link C++ class MatrixHolder<std::list<MatrixTObj*>,0>+;
+#pragma link C++ class MatrixHolder<std::set<int>,0>+;
+#pragma link C++ class MatrixHolder<std::set<MatrixObj>,0>+;
+#pragma link C++ class MatrixHolder<std::set<MatrixObj>,1>+;
+#pragma link C++ class MatrixHolder<std::set<MatrixTObj>,0>+;
+#pragma link C++ class MatrixHolder<std::set<MatrixTObj>,1>+;
+#pragma link C++ class MatrixHolder<std::set<MatrixTObj*>,0>+;
+#endif
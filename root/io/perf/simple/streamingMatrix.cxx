@@ -0,0 +1,212 @@
+// Container streaming throughput matrix.
+//
+// Runs the cases of the macros in this directory (vector/list/set of int,
+// of a class, of a TObject derived class and of pointers to it, streamed
+// member-wise or object-wise) as one matrix
+//
+//    <Write|Read>/<container>/<element>/<mode>/<compression>
+//
+// with mode OW (object-wise, split 0), MW (member-wise, split 0) or split
+// (split 99), and compression none, zlib, lz4 or zstd. One iteration writes
+// (or reads back) a cluster of --entries entries of --elements elements each
+// through a TTree in a TMemFile, so the numbers include the compression.
+// Each case is repeated (3 times by default) and reported with mean, median
+// and stddev; see scripts/pt_bench.h for the options, e.g.
+//
+//    streamingMatrix --benchmark_filter='/vector/' --benchmark_out=matrix.json
+//
+// In addition to bytes/s (uncompressed) and ns_per_item (per element), the
+// JSON reports the compression_ratio and zip_bytes_per_second of each case.
+
+#include "TMemFile.h"
+#include "TTree.h"
+#include "TClass.h"
+#include "TVirtualStreamerInfo.h"
+
+#include "matrixClasses.h"
+#include "scripts/pt_bench.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <type_traits>
+
+namespace {
+
+struct Compression {
+   const char *fName;
+   int fSetting;
+};
+
+const Compression gCompressions[] = {{"none", 0}, {"zlib", 101}, {"lz4", 404}, {"zstd", 505}};
+
+template <typename Element>
+Element MakeElement(int i)
+{
+   if constexpr (std::is_pointer<Element>::value)
+      return new typename std::remove_pointer<Element>::type(i);
+   else
+      return Element(i);
+}
+
+template <typename Holder>
+void FillHolder(Holder &holder, int nelements)
+{
+   using Element = typename decltype(holder.fContainer)::value_type;
+   holder.Reset();
+   for (int i = 0; i < nelements; ++i)
+      holder.fContainer.insert(holder.fContainer.end(), MakeElement<Element>(i));
+}
+
+// Creates the file and the tree, the caller owns both.
+template <typename Holder>
+TTree *MakeTree(TMemFile *&file, int compression, int split, Holder *&ptr)
+{
+   file = new TMemFile("streamingMatrix.root", "RECREATE", "", compression);
+   TTree *tree = new TTree("t", "t");
+   tree->SetAutoFlush(0); // flushed explicitly, once per iteration
+   tree->Branch("h", &ptr, 32000, split);
+   return tree;
+}
+
+template <typename Holder>
+void AddCase(PTBench::Runner &runner, const std::string &container, const std::string &element,
+             const std::string &mode, int nentries, int nelements)
+{
+   const int split = mode == "split" ? 99 : 0;
+   const bool memberwise = mode != "OW";
+   const bool ownsElements = std::is_pointer<typename decltype(Holder::fContainer)::value_type>::value;
+   const double nitems = double(nentries) * nelements;
+
+   for (const Compression &comp : gCompressions) {
+      const std::string name = container + "/" + element + "/" + mode + "/" + comp.fName;
+      const int setting = comp.fSetting;
+
+      runner.Add("Write/" + name, [=](PTBench::State &state) {
+         TVirtualStreamerInfo::SetStreamMemberWise(memberwise);
+         Holder proto;
+         FillHolder(proto, nelements);
+         Holder *ptr = &proto;
+         double bytes = 0., zipBytes = 0.;
+         while (state.KeepRunning()) {
+            state.PauseTiming();
+            TMemFile *file;
+            TTree *tree = MakeTree(file, setting, split, ptr);
+            state.ResumeTiming();
+            for (int i = 0; i < nentries; ++i)
+               tree->Fill();
+            tree->FlushBaskets();
+            state.PauseTiming();
+            bytes += tree->GetTotBytes();
+            zipBytes += tree->GetZipBytes();
+            delete tree;
+            delete file;
+            state.ResumeTiming();
+         }
+         state.SetBytesProcessed(bytes);
+         state.SetItemsProcessed(double(state.iterations()) * nitems);
+         state.counters["compression_ratio"] = zipBytes > 0. ? bytes / zipBytes : 0.;
+         state.counters["zip_bytes"] = zipBytes / state.iterations();
+      });
+
+      runner.Add("Read/" + name, [=](PTBench::State &state) {
+         TVirtualStreamerInfo::SetStreamMemberWise(memberwise);
+         Holder proto;
+         FillHolder(proto, nelements);
+         Holder *ptr = &proto;
+         TMemFile *file;
+         TTree *tree = MakeTree(file, setting, split, ptr);
+         for (int i = 0; i < nentries; ++i)
+            tree->Fill();
+         tree->FlushBaskets();
+         const double bytes = tree->GetTotBytes(), zipBytes = tree->GetZipBytes();
+
+         Holder *obj = new Holder;
+         tree->SetBranchAddress("h", &obj);
+         size_t size = 0;
+         while (state.KeepRunning()) {
+            for (int i = 0; i < nentries; ++i) {
+               if (ownsElements)
+                  obj->Reset(); // the pointees of the previous entry
+               tree->GetEntry(i);
+            }
+            size = obj->fContainer.size();
+         }
+         if (size != proto.fContainer.size())
+            state.SkipWithError("read " + std::to_string(size) + " elements, wrote " +
+                                std::to_string(proto.fContainer.size()));
+         tree->ResetBranchAddresses();
+         delete obj;
+         delete tree;
+         delete file;
+         state.SetBytesProcessed(double(state.iterations()) * bytes);
+         state.SetItemsProcessed(double(state.iterations()) * nitems);
+         state.counters["compression_ratio"] = zipBytes > 0. ? bytes / zipBytes : 0.;
+         state.counters["zip_bytes"] = zipBytes;
+      });
+   }
+}
+
+// All element kinds and modes of one container type.
+template <template <typename...> class Container>
+void AddContainer(PTBench::Runner &runner, const std::string &container, int nentries, int nelements)
+{
+   AddCase<MatrixHolder<Container<int>, 0>>(runner, container, "int", "OW", nentries, nelements);
+   AddCase<MatrixHolder<Container<MatrixObj>, 0>>(runner, container, "class", "OW", nentries, nelements);
+   AddCase<MatrixHolder<Container<MatrixObj>, 1>>(runner, container, "class", "MW", nentries, nelements);
+   AddCase<MatrixHolder<Container<MatrixObj>, 1>>(runner, container, "class", "split", nentries, nelements);
+   AddCase<MatrixHolder<Container<MatrixTObj>, 0>>(runner, container, "tclass", "OW", nentries, nelements);
+   AddCase<MatrixHolder<Container<MatrixTObj>, 1>>(runner, container, "tclass", "MW", nentries, nelements);
+   AddCase<MatrixHolder<Container<MatrixTObj>, 1>>(runner, container, "tclass", "split", nentries, nelements);
+   AddCase<MatrixHolder<Container<MatrixTObj *>, 0>>(runner, container, "ptrtclass", "OW", nentries, nelements);
+}
+
+// Builds the streamer infos of the Tag 1 (member-wise) and Tag 0
+// (object-wise) holders of one container type in their mode.
+template <template <typename...> class Container>
+void BuildStreamerInfos()
+{
+   TVirtualStreamerInfo::SetStreamMemberWise(kTRUE);
+   TClass::GetClass(typeid(MatrixHolder<Container<MatrixObj>, 1>))->GetStreamerInfo();
+   TClass::GetClass(typeid(MatrixHolder<Container<MatrixTObj>, 1>))->GetStreamerInfo();
+   TVirtualStreamerInfo::SetStreamMemberWise(kFALSE);
+   TClass::GetClass(typeid(MatrixHolder<Container<MatrixObj>, 0>))->GetStreamerInfo();
+   TClass::GetClass(typeid(MatrixHolder<Container<MatrixTObj>, 0>))->GetStreamerInfo();
+   TVirtualStreamerInfo::SetStreamMemberWise(kTRUE);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+   PTBench::Runner runner(argc, argv);
+   runner.SetRepetitions(3);
+
+   int nentries = 100;
+   int nelements = 600; // as in vectorMWclass.C
+   for (int i = 1; i < argc; ++i) {
+      std::string arg(argv[i]);
+      if (arg.compare(0, 10, "--entries=") == 0)
+         nentries = atoi(arg.c_str() + 10);
+      else if (arg.compare(0, 11, "--elements=") == 0)
+         nelements = atoi(arg.c_str() + 11);
+      else {
+         fprintf(stderr, "Usage: %s [--entries=N] [--elements=N] [--benchmark_...]\n", argv[0]);
+         return 2;
+      }
+   }
+   if (nentries < 1 || nelements < 1) {
+      fprintf(stderr, "%s: --entries and --elements must be positive\n", argv[0]);
+      return 2;
+   }
+
+   BuildStreamerInfos<std::vector>();
+   BuildStreamerInfos<std::list>();
+   BuildStreamerInfos<std::set>();
+
+   AddContainer<std::vector>(runner, "vector", nentries, nelements);
+   AddContainer<std::list>(runner, "list", nentries, nelements);
+   AddContainer<std::set>(runner, "set", nentries, nelements);
+
+   return runner.Run();
+}
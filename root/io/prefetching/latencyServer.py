@@ -0,0 +1,189 @@
+#!/usr/bin/env python3
+"""Local HTTP file server that injects network latency.
+
+Stand-in for the remote file of runPrefetchReading.C: serves the files of a
+directory with HTTP/1.1 single and multi range requests (as sent by TWebFile
+and TDavixFile), delaying each request by a round trip time plus a seeded,
+hence reproducible, jitter and limiting the transfer rate.
+
+   latencyServer.py [options]                   serve until interrupted
+   latencyServer.py [options] -- cmd [args...]  run cmd against the server
+
+With a command, the base URL of the server (e.g. http://127.0.0.1:4711/) is
+passed in the environment variable ROOTTEST_HTTP_URL, the server is stopped
+once the command finishes and the exit code of the command is returned.
+"""
+
+import argparse
+import os
+import random
+import re
+import subprocess
+import sys
+import threading
+import time
+from http.server import SimpleHTTPRequestHandler, ThreadingHTTPServer
+
+
+class LatencyModel:
+    """Request delay and transfer rate of the simulated link."""
+
+    def __init__(self, rtt, jitter, bandwidth, seed):
+        self.rtt = rtt / 1000.
+        self.jitter = jitter / 1000.
+        self.bandwidth = bandwidth * 1e6  # bytes/s, 0 is unlimited
+        self.random = random.Random(seed)
+        self.lock = threading.Lock()
+        self.requests = 0
+        self.bytes = 0
+
+    def delay(self):
+        with self.lock:
+            self.requests += 1
+            jitter = self.random.uniform(-self.jitter, self.jitter)
+        time.sleep(max(0., self.rtt + jitter))
+
+    def send(self, wfile, data):
+        # Write data in chunks paced at the bandwidth.
+        chunk = 64 * 1024
+        start = time.monotonic()
+        for pos in range(0, len(data), chunk):
+            wfile.write(data[pos:pos + chunk])
+            if self.bandwidth:
+                ahead = start + (pos + chunk) / self.bandwidth - time.monotonic()
+                if ahead > 0:
+                    time.sleep(ahead)
+        with self.lock:
+            self.bytes += len(data)
+
+
+class RangeHandler(SimpleHTTPRequestHandler):
+    protocol_version = 'HTTP/1.1'  # keep-alive, as expected by TWebFile
+
+    def log_message(self, format, *args):
+        if self.server.verbose:
+            super().log_message(format, *args)
+
+    def do_HEAD(self):
+        self.serve(False)
+
+    def do_GET(self):
+        self.serve(True)
+
+    def serve(self, with_body):
+        self.server.model.delay()
+        path = self.translate_path(self.path)
+        if not os.path.isfile(path):
+            self.send_error(404, 'File not found')
+            return
+        with open(path, 'rb') as f:
+            content = f.read()
+        size = len(content)
+
+        ranges = self.parse_ranges(self.headers.get('Range'), size)
+        if ranges is None:
+            self.send_error(416, 'Requested range not satisfiable')
+            return
+        if not ranges:
+            self.send_response(200)
+            self.send_header('Content-Type', 'application/octet-stream')
+            body = content
+        elif len(ranges) == 1:
+            first, last = ranges[0]
+            self.send_response(206)
+            self.send_header('Content-Type', 'application/octet-stream')
+            self.send_header('Content-Range', 'bytes %d-%d/%d' % (first, last, size))
+            body = content[first:last + 1]
+        else:
+            boundary = 'ROOTTEST_BOUNDARY'
+            parts = []
+            for first, last in ranges:
+                parts.append(('--%s\r\nContent-Type: application/octet-stream\r\n'
+                              'Content-Range: bytes %d-%d/%d\r\n\r\n'
+                              % (boundary, first, last, size)).encode())
+                parts.append(content[first:last + 1])
+                parts.append(b'\r\n')
+            parts.append(('--%s--\r\n' % boundary).encode())
+            body = b''.join(parts)
+            self.send_response(206)
+            self.send_header('Content-Type', 'multipart/byteranges; boundary=' + boundary)
+        self.send_header('Accept-Ranges', 'bytes')
+        self.send_header('Content-Length', str(len(body)))
+        self.end_headers()
+        if with_body:
+            self.server.model.send(self.wfile, body)
+
+    @staticmethod
+    def parse_ranges(header, size):
+        # Returns [] for the whole file, None if unsatisfiable. A malformed
+        # header is ignored, as RFC 9110 allows.
+        if not header:
+            return []
+        match = re.match(r'\s*bytes\s*=\s*(.*)', header)
+        if not match:
+            return []
+        ranges = []
+        for spec in match.group(1).split(','):
+            first, _, last = spec.strip().partition('-')
+            try:
+                if first:
+                    first = int(first)
+                    last = min(int(last), size - 1) if last else size - 1
+                else:  # suffix range
+                    first = max(0, size - int(last))
+                    last = size - 1
+            except ValueError:
+                return []
+            if first > last or first >= size:
+                continue
+            ranges.append((first, last))
+        return ranges or None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--dir', default='.', help='directory to serve (default: .)')
+    parser.add_argument('--port', type=int, default=0, help='port, 0 picks a free one (default)')
+    parser.add_argument('--rtt', type=float, default=20., help='round trip time in ms (default: 20)')
+    parser.add_argument('--jitter', type=float, default=0., help='max. deviation from the rtt in ms (default: 0)')
+    parser.add_argument('--bandwidth', type=float, default=0., help='MB/s, 0 is unlimited (default)')
+    parser.add_argument('--seed', type=int, default=1, help='seed of the jitter (default: 1)')
+    parser.add_argument('--verbose', action='store_true', help='log the requests')
+    argv = sys.argv[1:]
+    command = []
+    if '--' in argv:
+        command = argv[argv.index('--') + 1:]
+        argv = argv[:argv.index('--')]
+    args = parser.parse_args(argv)
+
+    directory = os.path.abspath(args.dir)
+    handler = lambda *a, **kw: RangeHandler(*a, directory=directory, **kw)
+    server = ThreadingHTTPServer(('127.0.0.1', args.port), handler)
+    server.daemon_threads = True
+    server.model = LatencyModel(args.rtt, args.jitter, args.bandwidth, args.seed)
+    server.verbose = args.verbose
+    url = 'http://127.0.0.1:%d/' % server.server_address[1]
+
+    if not command:
+        print('Serving %s at %s' % (directory, url), flush=True)
+        try:
+            server.serve_forever()
+        except KeyboardInterrupt:
+            pass
+        return 0
+
+    thread = threading.Thread(target=server.serve_forever, daemon=True)
+    thread.start()
+    env = dict(os.environ, ROOTTEST_HTTP_URL=url)
+    try:
+        ret = subprocess.call(command, env=env)
+    finally:
+        server.shutdown()
+    model = server.model
+    sys.stderr.write('latencyServer: %d requests, %d bytes\n' % (model.requests, model.bytes))
+    return ret
+
+
+if __name__ == '__main__':
+    sys.exit(main())
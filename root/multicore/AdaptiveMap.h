@@ -0,0 +1,62 @@
+#ifndef ROOTTEST_ADAPTIVEMAP_H
+#define ROOTTEST_ADAPTIVEMAP_H
+
+// Map and MapReduce on a TThreadExecutor with adaptive chunking.
+//
+// TThreadExecutor::MapReduce(func, args, redfunc, nChunks) cuts args into
+// nChunks chunks of equal size up front: with uneven costs per element the
+// pool waits for the chunk that drew the expensive elements. Here one task
+// per thread of the pool pulls chunks from a shared counter until all args
+// are done (guided self-scheduling): a chunk is the remaining work divided
+// by twice the number of threads, so chunks start large, to keep the
+// scheduling cost low, and get smaller towards the end, where they balance
+// the load. Idle threads of the pool steal the tasks of nested calls.
+//
+//    ROOT::TThreadExecutor pool;
+//    auto squares = AdaptiveMap(pool, [](int i) { return i * i; }, args);
+//    auto sum = AdaptiveMapReduce(pool, [](int i) { return i * i; }, args, redfunc);
+//
+// As for Map, the results are in the order of args. func must not return bool.
+
+#include "ROOT/TSeq.hxx"
+#include "ROOT/TThreadExecutor.hxx"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+template <typename F, typename T>
+auto AdaptiveMap(ROOT::TThreadExecutor &pool, F func, const std::vector<T> &args, size_t minGrain = 1)
+   -> std::vector<decltype(func(args[0]))>
+{
+   using Result_t = decltype(func(args[0]));
+   static_assert(!std::is_same<Result_t, bool>::value, "the elements of std::vector<bool> cannot be set concurrently");
+   const size_t n = args.size();
+   std::vector<Result_t> results(n);
+   const unsigned nTasks = std::max(1u, std::min<unsigned>(pool.GetPoolSize(), n));
+   std::atomic<size_t> next{0};
+   auto task = [&](unsigned) {
+      size_t begin = next.load(std::memory_order_relaxed);
+      while (begin < n) {
+         const size_t grain = std::min(n - begin, std::max(minGrain, (n - begin) / (2 * nTasks)));
+         if (!next.compare_exchange_weak(begin, begin + grain, std::memory_order_relaxed))
+            continue; // begin now holds the current value
+         for (size_t i = begin; i < begin + grain; ++i)
+            results[i] = func(args[i]);
+         begin = next.load(std::memory_order_relaxed);
+      }
+   };
+   pool.Foreach(task, ROOT::TSeqU(nTasks));
+   return results;
+}
+
+template <typename F, typename T, typename R>
+auto AdaptiveMapReduce(ROOT::TThreadExecutor &pool, F func, const std::vector<T> &args, R redfunc,
+                       size_t minGrain = 1)
+{
+   return redfunc(AdaptiveMap(pool, func, args, minGrain));
+}
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef ROOTTEST_SHMTRANSPORT_H
+#define ROOTTEST_SHMTRANSPORT_H
+
+// Histogram results of TProcessExecutor workers passed through shared memory.
+//
+// TProcessExecutor streams every result of a worker into a TMessage, sends
+// it over a socket and streams it back in the parent before the reduction.
+// Here the parent maps a shared anonymous arena of one slot per task before
+// the workers are forked; a worker copies the bin contents, sums of squares
+// of weights and statistics of its histogram into the slot of its task and
+// returns only the slot number. The parent then adds the slots directly
+// into its result, without streaming.
+//
+//    TH2D model("h", "", 1000, 0, 1, 1000, 0, 1);
+//    ShmArena arena(nTasks, ShmHistoBytes(model));
+//    ROOT::TProcessExecutor pool;
+//    auto slots = pool.Map([&](unsigned task) {
+//       TH2D h(model);
+//       ... fill h ...
+//       return ShmPutHisto(arena, task, h);
+//    }, ROOT::TSeqU(nTasks));
+//    TH2D result(model);
+//    for (unsigned slot : slots)
+//       ShmAddHisto(result, arena, slot);
+//
+// Histograms must keep their bins in a TArrayD (TH1D, TH2D, TH3D) and have
+// the binning of the model; the arena must be created before the Map.
+
+#include "TArrayD.h"
+#include "TH1.h"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+class ShmArena {
+private:
+   char *fBase = nullptr;
+   unsigned fNSlots;
+   size_t fSlotBytes;
+
+public:
+   ShmArena(unsigned nSlots, size_t slotBytes) : fNSlots(nSlots), fSlotBytes(slotBytes)
+   {
+      void *base = mmap(nullptr, nSlots * slotBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+      if (base == MAP_FAILED)
+         throw std::runtime_error("ShmArena: cannot map the arena");
+      fBase = static_cast<char *>(base);
+   }
+   ~ShmArena() { munmap(fBase, fNSlots * fSlotBytes); }
+   ShmArena(const ShmArena &) = delete;
+   ShmArena &operator=(const ShmArena &) = delete;
+
+   void *GetSlot(unsigned slot) const
+   {
+      if (slot >= fNSlots)
+         throw std::runtime_error("ShmArena: no such slot");
+      return fBase + slot * fSlotBytes;
+   }
+   size_t GetSlotBytes() const { return fSlotBytes; }
+};
+
+struct ShmHistoHeader {
+   enum { kNStats = 13 }; // as TH1::kNstat
+   Int_t fNCells;
+   Int_t fHasSumw2;
+   Double_t fEntries;
+   Double_t fStats[kNStats];
+};
+
+inline size_t ShmHistoBytes(const TH1 &model)
+{
+   // Bytes of a slot for histograms of the binning of model, with their sums of squares of weights.
+   return sizeof(ShmHistoHeader) + 2 * sizeof(Double_t) * model.GetNcells();
+}
+
+template <typename HIST>
+unsigned ShmPutHisto(const ShmArena &arena, unsigned slot, const HIST &h)
+{
+   static_assert(std::is_base_of<TArrayD, HIST>::value, "the bins must be a TArrayD");
+   auto header = static_cast<ShmHistoHeader *>(arena.GetSlot(slot));
+   const Int_t ncells = h.GetNcells();
+   if (sizeof(ShmHistoHeader) + 2 * sizeof(Double_t) * ncells > arena.GetSlotBytes())
+      throw std::runtime_error("ShmPutHisto: the histogram does not fit in a slot");
+   header->fNCells = ncells;
+   header->fHasSumw2 = h.GetSumw2N() == ncells;
+   header->fEntries = h.GetEntries();
+   std::fill(header->fStats, header->fStats + ShmHistoHeader::kNStats, 0.);
+   h.GetStats(header->fStats);
+   auto bins = reinterpret_cast<Double_t *>(header + 1);
+   memcpy(bins, static_cast<const TArrayD &>(h).GetArray(), ncells * sizeof(Double_t));
+   if (header->fHasSumw2)
+      memcpy(bins + ncells, h.GetSumw2()->GetArray(), ncells * sizeof(Double_t));
+   return slot;
+}
+
+template <typename HIST>
+void ShmAddHisto(HIST &result, const ShmArena &arena, unsigned slot)
+{
+   static_assert(std::is_base_of<TArrayD, HIST>::value, "the bins must be a TArrayD");
+   auto header = static_cast<const ShmHistoHeader *>(arena.GetSlot(slot));
+   const Int_t ncells = result.GetNcells();
+   if (header->fNCells != ncells)
+      throw std::runtime_error("ShmAddHisto: the binning differs from the result");
+   // Take the statistics before touching the bins: for an empty result they would be recomputed from them.
+   Double_t stats[ShmHistoHeader::kNStats] = {0.};
+   result.GetStats(stats);
+   const Double_t entries = result.GetEntries() + header->fEntries;
+   if (header->fHasSumw2 && result.GetSumw2N() != ncells)
+      result.Sumw2();
+   auto bins = reinterpret_cast<const Double_t *>(header + 1);
+   Double_t *resultBins = static_cast<TArrayD &>(result).GetArray();
+   for (Int_t i = 0; i < ncells; ++i)
+      resultBins[i] += bins[i];
+   if (result.GetSumw2N() == ncells) {
+      // Without Sumw2 in the slot the weights were 1, as TH1::Add assumes.
+      const Double_t *sumw2 = header->fHasSumw2 ? bins + ncells : bins;
+      Double_t *resultSumw2 = result.GetSumw2()->GetArray();
+      for (Int_t i = 0; i < ncells; ++i)
+         resultSumw2[i] += sumw2[i];
+   }
+   for (int i = 0; i < ShmHistoHeader::kNStats; ++i)
+      stats[i] += header->fStats[i];
+   result.PutStats(stats);
+   result.SetEntries(entries);
+}
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef ROOTTEST_SUBCLUSTERPROCESSOR_H
+#define ROOTTEST_SUBCLUSTERPROCESSOR_H
+
+// Processes a tree in parallel with tasks smaller than a cluster.
+//
+// TTreeProcessorMT creates (at most) one task per cluster, so a file written
+// with a large autoflush, e.g. 2 clusters, keeps at most 2 cores busy. Here
+// the clusters are split into entry ranges at basket boundaries of the
+// largest branch: each task reads and decompresses only the baskets of its
+// range, so the baskets of the dominant branch are decompressed exactly once
+// and only the baskets of the other branches that cross a boundary are
+// decompressed by both neighbouring tasks.
+//
+//    SubClusterProcessor proc("file.root", "tree", 16);
+//    proc.Process([](TTreeReader &reader) { while (reader.Next()) ... });
+
+#include "TBranch.h"
+#include "TError.h"
+#include "TFile.h"
+#include "TObjArray.h"
+#include "TROOT.h"
+#include "TTree.h"
+#include "TTreeReader.h"
+#include "ROOT/TSeq.hxx"
+#include "ROOT/TThreadExecutor.hxx"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+class SubClusterProcessor {
+public:
+   using Range_t = std::pair<Long64_t, Long64_t>; // [begin, end)
+
+private:
+   std::string fFileName;
+   std::string fTreeName;
+   std::vector<Range_t> fClusters;
+   std::vector<Range_t> fRanges;
+
+   static TBranch *FindLargestBranch(TObjArray *branches, TBranch *largest)
+   {
+      // Branch with baskets (i.e. without sub-branches) and the most compressed bytes.
+      for (Int_t i = 0; branches && i < branches->GetEntriesFast(); ++i) {
+         auto branch = static_cast<TBranch *>(branches->UncheckedAt(i));
+         if (branch->GetListOfBranches()->GetEntriesFast() > 0)
+            largest = FindLargestBranch(branch->GetListOfBranches(), largest);
+         else if (!largest || branch->GetZipBytes() > largest->GetZipBytes())
+            largest = branch;
+      }
+      return largest;
+   }
+
+   static Long64_t ClosestBasketStart(const std::vector<Long64_t> &starts, Long64_t target, Long64_t lo, Long64_t hi)
+   {
+      // Basket start in (lo, hi) closest to target, target if there is none.
+      Long64_t best = target, bestDist = -1;
+      auto iter = std::lower_bound(starts.begin(), starts.end(), target);
+      if (iter != starts.end() && *iter < hi) {
+         best = *iter;
+         bestDist = *iter - target;
+      }
+      if (iter != starts.begin() && *(iter - 1) > lo && (bestDist < 0 || target - *(iter - 1) < bestDist))
+         best = *(iter - 1);
+      return best;
+   }
+
+public:
+   SubClusterProcessor(const std::string &fileName, const std::string &treeName, unsigned nTasks = 0)
+      : fFileName(fileName), fTreeName(treeName)
+   {
+      // nTasks is the number of tasks to aim for, by default two per thread.
+      if (nTasks == 0)
+         nTasks = 2 * std::max(1u, ROOT::GetThreadPoolSize());
+      std::unique_ptr<TFile> file(TFile::Open(fileName.c_str()));
+      TTree *tree = nullptr;
+      if (file)
+         file->GetObject(treeName.c_str(), tree);
+      if (!tree) {
+         Error("SubClusterProcessor", "cannot read tree %s from %s", treeName.c_str(), fileName.c_str());
+         return;
+      }
+      const Long64_t nentries = tree->GetEntries();
+      TTree::TClusterIterator clusterIter = tree->GetClusterIterator(0);
+      Long64_t start;
+      while ((start = clusterIter()) < nentries)
+         fClusters.emplace_back(start, std::min(clusterIter.GetNextEntry(), nentries));
+
+      // Entries at which the largest branch starts a basket.
+      std::vector<Long64_t> basketStarts;
+      if (TBranch *largest = FindLargestBranch(tree->GetListOfBranches(), nullptr)) {
+         const Long64_t *entries = largest->GetBasketEntry();
+         for (Int_t b = 0; b < largest->GetWriteBasket(); ++b)
+            basketStarts.push_back(entries[b]);
+      }
+
+      for (const Range_t &cluster : fClusters) {
+         const Long64_t size = cluster.second - cluster.first;
+         const Long64_t parts = std::max<Long64_t>(1, (nTasks * size + nentries - 1) / std::max<Long64_t>(1, nentries));
+         Long64_t begin = cluster.first;
+         for (Long64_t p = 1; p <= parts; ++p) {
+            Long64_t end = cluster.first + size * p / parts;
+            if (p < parts)
+               end = ClosestBasketStart(basketStarts, end, begin, cluster.second);
+            if (end > begin) {
+               fRanges.emplace_back(begin, end);
+               begin = end;
+            }
+         }
+      }
+   }
+
+   const std::vector<Range_t> &GetClusters() const { return fClusters; }
+   const std::vector<Range_t> &GetRanges() const { return fRanges; }
+
+   bool Process(std::function<void(TTreeReader &)> func) const
+   {
+      // Calls func once per range, in parallel, with a TTreeReader limited to
+      // the range. Returns false if the tree could not be read for a range.
+      ROOT::TThreadExecutor pool;
+      std::atomic<unsigned> failed(0);
+      auto task = [&](unsigned i) {
+         const Range_t &range = fRanges[i];
+         std::unique_ptr<TFile> file(TFile::Open(fFileName.c_str()));
+         TTree *tree = nullptr;
+         if (file)
+            file->GetObject(fTreeName.c_str(), tree);
+         if (!tree) {
+            Error("SubClusterProcessor::Process", "cannot read tree %s from %s for entries %lld-%lld",
+                  fTreeName.c_str(), fFileName.c_str(), range.first, range.second);
+            ++failed;
+            return;
+         }
+         tree->SetCacheEntryRange(range.first, range.second);
+         TTreeReader reader(tree);
+         reader.SetEntriesRange(range.first, range.second);
+         func(reader);
+      };
+      pool.Foreach(task, ROOT::TSeqU(fRanges.size()));
+      return failed == 0;
+   }
+};
+
+#endif
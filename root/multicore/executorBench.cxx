@@ -0,0 +1,168 @@
+// Static vs adaptive chunking of TThreadExecutor::MapReduce on skewed workloads.
+//
+//    executorBench [--elements=N] [--mean-cost=N] [--threads=N] [--benchmark_...]
+//
+// Maps a busy loop of cost iterations over --elements costs (default 4096)
+// with a mean of --mean-cost iterations (default 20000) and sums the results,
+// for the workloads
+//
+//    uniform       all costs equal
+//    exponential   exponentially distributed costs
+//    sorted        the same costs, most expensive first, as for a fit farm
+//                  fed in order of complexity
+//    nested        a MapReduce over sqrt(--elements) elements, each a
+//                  MapReduce over sqrt(--elements) exponential costs
+//
+// with the schedules
+//
+//    static    MapReduce(func, args, redfunc, nChunks), one chunk per thread
+//    default   MapReduce(func, args, redfunc), one task per element
+//    adaptive  AdaptiveMapReduce of AdaptiveMap.h
+//
+// on a pool of --threads threads (default: all cores). Items are elements.
+// Checks every sum against the sequential one. See scripts/pt_bench.h for
+// the remaining options.
+
+#include "ROOT/TThreadExecutor.hxx"
+#include "TRandom3.h"
+
+#include "AdaptiveMap.h"
+#include "scripts/pt_bench.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+enum class ESchedule { kStatic, kDefault, kAdaptive };
+
+double Work(int cost)
+{
+   double sum = 0.;
+   for (int i = 0; i < cost; ++i)
+      sum += std::sin(i * 1e-3);
+   return sum;
+}
+
+double Sum(const std::vector<double> &v)
+{
+   return std::accumulate(v.begin(), v.end(), 0.);
+}
+
+std::vector<int> ExponentialCosts(size_t n, double mean, unsigned seed)
+{
+   TRandom3 rnd(seed);
+   std::vector<int> costs(n);
+   for (int &c : costs)
+      c = int(rnd.Exp(mean)) + 1;
+   return costs;
+}
+
+double MapReduce(ROOT::TThreadExecutor &pool, ESchedule schedule, std::vector<int> &costs)
+{
+   auto func = [](int cost) { return Work(cost); };
+   switch (schedule) {
+   case ESchedule::kStatic: return pool.MapReduce(func, costs, Sum, pool.GetPoolSize());
+   case ESchedule::kDefault: return pool.MapReduce(func, costs, Sum);
+   default: return AdaptiveMapReduce(pool, func, costs, Sum);
+   }
+}
+
+// The sum of a nested MapReduce: element i of outer maps over inner[i].
+double NestedMapReduce(ROOT::TThreadExecutor &pool, ESchedule schedule, std::vector<std::vector<int>> &inner)
+{
+   std::vector<int> outer(inner.size());
+   std::iota(outer.begin(), outer.end(), 0);
+   auto func = [&](int i) { return MapReduce(pool, schedule, inner[i]); };
+   switch (schedule) {
+   case ESchedule::kStatic: return pool.MapReduce(func, outer, Sum, pool.GetPoolSize());
+   case ESchedule::kDefault: return pool.MapReduce(func, outer, Sum);
+   default: return AdaptiveMapReduce(pool, func, outer, Sum);
+   }
+}
+
+void RunMapReduce(PTBench::State &state, std::function<double()> run, double expected, size_t elements)
+{
+   double sum = 0.;
+   while (state.KeepRunning())
+      sum = run();
+   if (std::abs(sum - expected) > 1e-9 * std::abs(expected))
+      state.SkipWithError("wrong sum " + std::to_string(sum) + ", expected " + std::to_string(expected));
+   state.SetItemsProcessed(double(state.iterations()) * elements);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+   PTBench::Runner runner(argc, argv);
+
+   size_t elements = 4096;
+   double meanCost = 20000;
+   unsigned nThreads = std::thread::hardware_concurrency();
+   for (int i = 1; i < argc; ++i) {
+      std::string arg(argv[i]);
+      if (arg.compare(0, 11, "--elements=") == 0)
+         elements = atoll(arg.c_str() + 11);
+      else if (arg.compare(0, 12, "--mean-cost=") == 0)
+         meanCost = atof(arg.c_str() + 12);
+      else if (arg.compare(0, 10, "--threads=") == 0)
+         nThreads = atoi(arg.c_str() + 10);
+      else {
+         fprintf(stderr, "Usage: %s [--elements=N] [--mean-cost=N] [--threads=N] [--benchmark_...]\n", argv[0]);
+         return 2;
+      }
+   }
+   ROOT::TThreadExecutor pool(std::max(1u, nThreads));
+
+   std::vector<int> uniform(elements, int(meanCost));
+   std::vector<int> exponential = ExponentialCosts(elements, meanCost, 4357);
+   std::vector<int> sorted = exponential;
+   std::sort(sorted.begin(), sorted.end(), std::greater<int>());
+   const size_t side = std::max<size_t>(1, std::sqrt(double(elements)));
+   std::vector<std::vector<int>> nested;
+   for (size_t i = 0; i < side; ++i)
+      nested.push_back(ExponentialCosts(side, meanCost, 4357 + i));
+
+   auto sequential = [](const std::vector<int> &costs) {
+      double sum = 0.;
+      for (int c : costs)
+         sum += Work(c);
+      return sum;
+   };
+   double nestedSum = 0.;
+   for (const auto &inner : nested)
+      nestedSum += sequential(inner);
+
+   const std::pair<ESchedule, const char *> schedules[] = {
+      {ESchedule::kStatic, "static"}, {ESchedule::kDefault, "default"}, {ESchedule::kAdaptive, "adaptive"}};
+   const std::pair<std::vector<int> *, const char *> workloads[] = {
+      {&uniform, "uniform"}, {&exponential, "exponential"}, {&sorted, "sorted"}};
+   for (auto workload : workloads) {
+      std::vector<int> &costs = *workload.first;
+      const double expected = sequential(costs);
+      for (auto schedule : schedules) {
+         const ESchedule s = schedule.first;
+         runner.Add(std::string("MapReduce/") + workload.second + "/" + schedule.second,
+                    [&pool, &costs, s, expected](PTBench::State &state) {
+                       RunMapReduce(state, [&] { return MapReduce(pool, s, costs); }, expected, costs.size());
+                    });
+      }
+   }
+   for (auto schedule : schedules) {
+      const ESchedule s = schedule.first;
+      runner.Add(std::string("MapReduce/nested/") + schedule.second,
+                 [&pool, &nested, s, nestedSum, side](PTBench::State &state) {
+                    RunMapReduce(state, [&] { return NestedMapReduce(pool, s, nested); }, nestedSum, side * side);
+                 });
+   }
+
+   return runner.Run();
+}
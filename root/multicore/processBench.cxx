@@ -0,0 +1,147 @@
+// Socket vs shared memory transport of TProcessExecutor histogram results.
+//
+//    processBench [--bins=N] [--tasks=N] [--workers=N] [--fills=N] [--benchmark_...]
+//
+// Every task fills a TH2D of --bins x --bins bins (default 2000 x 2000, with
+// the sums of squares of weights 64 MB) with --fills weighted entries
+// (default 100000); the parent sums the --tasks results (default 32) of
+// --workers processes (default: all cores), with
+//
+//    Reduce/socket  MapReduce returning the TH2D, streamed to the parent and
+//                   merged with TH1::Merge
+//    Reduce/shm     Map returning the slot of ShmTransport.h the worker put
+//                   its TH2D in, added by ShmAddHisto
+//
+// Bytes/s are histogram bytes reduced. Checks that both give the same sum
+// of weights and entries. See scripts/pt_bench.h for the remaining options.
+
+#include "ROOT/TProcessExecutor.hxx"
+#include "ROOT/TSeq.hxx"
+#include "TH2D.h"
+#include "TList.h"
+#include "TRandom3.h"
+#include "TROOT.h"
+
+#include "ShmTransport.h"
+#include "scripts/pt_bench.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+void Fill(TH2D &h, unsigned task, int fills)
+{
+   TRandom3 rnd(task + 1);
+   for (int i = 0; i < fills; ++i)
+      h.Fill(rnd.Rndm(), rnd.Rndm(), rnd.Rndm());
+}
+
+TH2D *MergeAll(const std::vector<TH2D *> &histos)
+{
+   TList others;
+   for (size_t i = 1; i < histos.size(); ++i)
+      others.Add(histos[i]);
+   histos[0]->Merge(&others);
+   others.Delete();
+   return histos[0];
+}
+
+bool Check(PTBench::State &state, const TH2D &h, double entries, double sumw)
+{
+   if (h.GetEntries() != entries || std::abs(h.GetSumOfWeights() - sumw) > 1e-9 * sumw) {
+      state.SkipWithError("wrong result: " + std::to_string(h.GetEntries()) + " entries, sum of weights " +
+                          std::to_string(h.GetSumOfWeights()));
+      return false;
+   }
+   return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+   PTBench::Runner runner(argc, argv);
+
+   int bins = 2000;
+   unsigned nTasks = 32;
+   unsigned nWorkers = std::thread::hardware_concurrency();
+   int fills = 100000;
+   for (int i = 1; i < argc; ++i) {
+      std::string arg(argv[i]);
+      if (arg.compare(0, 7, "--bins=") == 0)
+         bins = atoi(arg.c_str() + 7);
+      else if (arg.compare(0, 8, "--tasks=") == 0)
+         nTasks = atoi(arg.c_str() + 8);
+      else if (arg.compare(0, 10, "--workers=") == 0)
+         nWorkers = atoi(arg.c_str() + 10);
+      else if (arg.compare(0, 8, "--fills=") == 0)
+         fills = atoi(arg.c_str() + 8);
+      else {
+         fprintf(stderr, "Usage: %s [--bins=N] [--tasks=N] [--workers=N] [--fills=N] [--benchmark_...]\n", argv[0]);
+         return 2;
+      }
+   }
+   // On MacOS, Cocoa spawns threads, which breaks fork.
+   gROOT->SetBatch(kTRUE);
+   TH1::AddDirectory(false);
+
+   TH2D model("h", "", bins, 0, 1, bins, 0, 1);
+   model.Sumw2();
+   const double histoBytes = ShmHistoBytes(model);
+
+   // The expected sum of weights and entries.
+   double sumw = 0.;
+   for (unsigned task = 0; task < nTasks; ++task) {
+      TRandom3 rnd(task + 1);
+      for (int i = 0; i < fills; ++i) {
+         rnd.Rndm();
+         rnd.Rndm();
+         sumw += rnd.Rndm();
+      }
+   }
+   const double entries = double(nTasks) * fills;
+
+   runner.Add("Reduce/socket", [&](PTBench::State &state) {
+      ROOT::TProcessExecutor pool(nWorkers);
+      while (state.KeepRunning()) {
+         auto task = [&](unsigned t) {
+            auto h = new TH2D(model);
+            Fill(*h, t, fills);
+            return h;
+         };
+         std::unique_ptr<TH2D> result(pool.MapReduce(task, ROOT::TSeqU(nTasks), MergeAll));
+         if (!Check(state, *result, entries, sumw))
+            break;
+      }
+      state.SetBytesProcessed(double(state.iterations()) * nTasks * histoBytes);
+      state.SetItemsProcessed(double(state.iterations()) * nTasks);
+   });
+
+   runner.Add("Reduce/shm", [&](PTBench::State &state) {
+      ROOT::TProcessExecutor pool(nWorkers);
+      ShmArena arena(nTasks, histoBytes);
+      while (state.KeepRunning()) {
+         auto task = [&](unsigned t) {
+            TH2D h(model);
+            Fill(h, t, fills);
+            return ShmPutHisto(arena, t, h);
+         };
+         std::vector<unsigned> slots = pool.Map(task, ROOT::TSeqU(nTasks));
+         TH2D result(model);
+         for (unsigned slot : slots)
+            ShmAddHisto(result, arena, slot);
+         if (!Check(state, result, entries, sumw))
+            break;
+      }
+      state.SetBytesProcessed(double(state.iterations()) * nTasks * histoBytes);
+      state.SetItemsProcessed(double(state.iterations()) * nTasks);
+   });
+
+   return runner.Run();
+}
@@ -0,0 +1,123 @@
+// A file with 2 clusters must keep up to 8 threads busy, as many as the pool
+// has, when processed with SubClusterProcessor, while TTreeProcessorMT is
+// limited to one task per cluster.
+
+#include "TFile.h"
+#include "TROOT.h"
+#include "TTree.h"
+#include "TTreeReader.h"
+#include "TTreeReaderValue.h"
+#include "ROOT/TTreeProcessorMT.hxx"
+
+#include "SubClusterProcessor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+const char *kFileName = "tp_subcluster.root";
+const char *kTreeName = "events";
+const Long64_t kEntries = 200000;
+
+void WriteTwoClusters()
+{
+   // Legacy layout: autoflush of half the tree, small baskets.
+   TFile f(kFileName, "RECREATE");
+   TTree t(kTreeName, kTreeName);
+   t.SetAutoFlush(kEntries / 2);
+   int evtNum;
+   std::vector<float> tracks;
+   t.Branch("evtNum", &evtNum, 4000);
+   t.Branch("tracks", &tracks, 32000);
+   for (Long64_t i = 0; i < kEntries; ++i) {
+      evtNum = i;
+      tracks.assign(i % 10, 0.5f * (i % 7));
+      t.Fill();
+   }
+   t.Write();
+}
+
+int main()
+{
+   const unsigned kNThreads = 8;
+   WriteTwoClusters();
+   // The pool is smaller than 8 threads on machines with fewer cores.
+   ROOT::EnableImplicitMT(kNThreads);
+
+   // TTreeProcessorMT: at most one task per cluster.
+   ROOT::TTreeProcessorMT::SetTasksPerWorkerHint(1024);
+   std::atomic<int> clusterTasks(0);
+   ROOT::TTreeProcessorMT tp(kFileName, kTreeName);
+   tp.Process([&](TTreeReader &reader) {
+      ++clusterTasks;
+      while (reader.Next())
+         ;
+   });
+
+   SubClusterProcessor proc(kFileName, kTreeName, 2 * kNThreads);
+   std::cout << "clusters: " << proc.GetClusters().size() << std::endl;
+   std::cout << "TTreeProcessorMT tasks: " << clusterTasks << std::endl;
+   std::cout << "sub-cluster ranges: " << proc.GetRanges().size() << std::endl;
+
+   // The ranges must cover all entries exactly once.
+   Long64_t next = 0;
+   for (const auto &range : proc.GetRanges()) {
+      if (range.first != next || range.second <= range.first)
+         std::cerr << "ERROR: bad range " << range.first << "-" << range.second << std::endl;
+      next = range.second;
+   }
+   if (next != kEntries)
+      std::cerr << "ERROR: ranges end at " << next << " instead of " << kEntries << std::endl;
+
+   // Every task waits until as many tasks as threads, up to 8, run at the
+   // same time, which only a split of the clusters allows beyond 2.
+   const int wanted = std::min(kNThreads, ROOT::GetThreadPoolSize());
+   int running = 0, peak = 0;
+   std::mutex mutex;
+   std::condition_variable allRunning;
+   Long64_t entries = 0, evtNumSum = 0;
+   double trackSum = 0.;
+   const bool processed = proc.Process([&](TTreeReader &reader) {
+      {
+         std::unique_lock<std::mutex> lock(mutex);
+         peak = std::max(peak, ++running);
+         allRunning.notify_all();
+         allRunning.wait_for(lock, std::chrono::seconds(10), [&] { return peak >= wanted; });
+      }
+
+      TTreeReaderValue<int> evtNum(reader, "evtNum");
+      TTreeReaderValue<std::vector<float>> tracks(reader, "tracks");
+      Long64_t n = 0, sum = 0;
+      double tsum = 0.;
+      while (reader.Next()) {
+         ++n;
+         sum += *evtNum;
+         for (float t : *tracks)
+            tsum += t;
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      --running;
+      entries += n;
+      evtNumSum += sum;
+      trackSum += tsum;
+   });
+
+   double expectedTrackSum = 0.;
+   for (Long64_t i = 0; i < kEntries; ++i)
+      expectedTrackSum += (i % 10) * 0.5f * (i % 7);
+   if (!processed)
+      std::cerr << "ERROR: the tree could not be read for some ranges" << std::endl;
+   std::cout << "entries: " << entries << std::endl;
+   if (evtNumSum != kEntries * (kEntries - 1) / 2 || std::abs(trackSum - expectedTrackSum) > 1e-6 * expectedTrackSum)
+      std::cerr << "ERROR: wrong content, evtNum sum " << evtNumSum << " track sum " << trackSum << std::endl;
+   if (peak < wanted)
+      std::cerr << "ERROR: at most " << peak << " of " << wanted << " tasks ran concurrently" << std::endl;
+   else
+      std::cout << "concurrent tasks: min(8, pool size)" << std::endl;
+   return 0;
+}
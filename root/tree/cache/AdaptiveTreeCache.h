@@ -0,0 +1,103 @@
+#ifndef ROOTTEST_ADAPTIVETREECACHE_H
+#define ROOTTEST_ADAPTIVETREECACHE_H
+
+// TTreeCache that sizes itself to the cluster it is about to read.
+//
+// Before each fill, the buffer is resized to the compressed size of the
+// cached branches in the next cluster times a headroom factor, within
+// [min, max]. A fixed size either thrashes on large clusters (several fills,
+// i.e. reads, per cluster) or wastes memory on small ones. If a cluster
+// nevertheless needs more than one fill, e.g. because of a branch added
+// after the learning phase, the headroom grows.
+//
+//    AdaptiveTreeCache *cache = AdaptiveTreeCache::Install(tree);
+//    ... read ...
+//    cache->GetPeakBufferSize(), cache->GetNumFills()
+
+#include "TBranch.h"
+#include "TFile.h"
+#include "TMath.h"
+#include "TObjArray.h"
+#include "TTree.h"
+#include "TTreeCache.h"
+
+class AdaptiveTreeCache : public TTreeCache {
+private:
+   Long64_t fMinSize;
+   Long64_t fMaxSize;
+   Double_t fHeadroom = 1.1;
+   Long64_t fFilledCluster = -1; // first entry of the last filled cluster
+   Long64_t fPeakBufferSize = 0;
+   Int_t fNumResizes = 0;
+   Int_t fNumFills = 0;
+   Int_t fNumRefills = 0; // fills of an already filled cluster
+
+   Long64_t GetClusterBytes(Long64_t start, Long64_t end) const
+   {
+      // Compressed size of the baskets of the cached branches in [start, end).
+      Long64_t bytes = 0;
+      const TObjArray *branches = GetCachedBranches();
+      for (Int_t i = 0; branches && i < branches->GetEntriesFast(); ++i) {
+         TBranch *branch = static_cast<TBranch *>(branches->UncheckedAt(i));
+         const Long64_t *entries = branch->GetBasketEntry();
+         const Int_t *sizes = branch->GetBasketBytes();
+         for (Int_t b = 0; b < branch->GetWriteBasket(); ++b) {
+            if (entries[b] >= end)
+               break;
+            if (entries[b] >= start)
+               bytes += sizes[b];
+         }
+      }
+      return bytes;
+   }
+
+public:
+   AdaptiveTreeCache(TTree *tree, Long64_t minSize = 64 * 1024, Long64_t maxSize = 256 * 1024 * 1024)
+      : TTreeCache(tree, minSize), fMinSize(minSize), fMaxSize(maxSize)
+   {
+   }
+
+   static AdaptiveTreeCache *Install(TTree *tree, Long64_t minSize = 64 * 1024, Long64_t maxSize = 256 * 1024 * 1024)
+   {
+      // Replace the cache of tree by an AdaptiveTreeCache. The file only refers
+      // to it, the tree deletes it: do not delete it yourself.
+      TFile *file = tree->GetCurrentFile();
+      if (!file)
+         return nullptr;
+      tree->SetCacheSize(0);
+      AdaptiveTreeCache *cache = new AdaptiveTreeCache(tree, minSize, maxSize);
+      file->SetCacheRead(cache, tree);
+      return cache;
+   }
+
+   Bool_t FillBuffer() override
+   {
+      Long64_t entry = fTree->GetReadEntry();
+      if (!IsLearning() && entry >= 0 && (entry < fEntryCurrent || entry >= fEntryNext)) {
+         TTree::TClusterIterator clusterIter = fTree->GetClusterIterator(entry);
+         Long64_t start = clusterIter();
+         Long64_t end = clusterIter.GetNextEntry();
+         if (start == fFilledCluster) {
+            ++fNumRefills;
+            fHeadroom = TMath::Min(4., fHeadroom * 1.5);
+         }
+         fFilledCluster = start;
+         Long64_t target = Long64_t(fHeadroom * GetClusterBytes(start, end));
+         target = TMath::Max(fMinSize, TMath::Min(fMaxSize, target));
+         if (target != GetBufferSize() && SetBufferSize(target) >= 0)
+            ++fNumResizes;
+         fPeakBufferSize = TMath::Max(fPeakBufferSize, (Long64_t)GetBufferSize());
+      }
+      Bool_t filled = TTreeCache::FillBuffer();
+      if (filled)
+         ++fNumFills;
+      return filled;
+   }
+
+   Long64_t GetPeakBufferSize() const { return fPeakBufferSize; }
+   Int_t GetNumFills() const { return fNumFills; }
+   Int_t GetNumResizes() const { return fNumResizes; }
+   Int_t GetNumRefills() const { return fNumRefills; }
+};
+
+#endif
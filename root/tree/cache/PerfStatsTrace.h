@@ -0,0 +1,137 @@
+#ifndef ROOTTEST_PERFSTATSTRACE_H
+#define ROOTTEST_PERFSTATSTRACE_H
+
+// TTreePerfStats that also records every file read and basket decompression
+// as a trace event and saves them in the Chrome trace event format, which
+// chrome://tracing and https://ui.perfetto.dev display as a timeline:
+//
+//    PerfStatsTrace *ps = new PerfStatsTrace("io", tree);
+//    ... read ...
+//    ps->SaveTrace("io.trace.json");
+//
+// Reads ("read") carry the file offset, the size and the entry being read;
+// decompressions ("unzip", named after the branch) carry the basket offset,
+// compressed and uncompressed size. Both carry the id of the thread, so the
+// work of TTreeCacheUnzip shows up on its own tracks.
+
+#include "TBranch.h"
+#include "TFile.h"
+#include "TObjArray.h"
+#include "TTimeStamp.h"
+#include "TTree.h"
+#include "TTreePerfStats.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class PerfStatsTrace : public TTreePerfStats {
+public:
+   struct Event {
+      bool fIsRead;      // read, otherwise unzip
+      double fStart;     // s, as TTimeStamp::AsDouble()
+      double fDuration;  // s
+      int fThread;       // sequential id, 0 is the first thread seen
+      Long64_t fOffset;  // of the read or of the basket
+      Long64_t fSize;    // bytes read, or compressed basket size
+      Long64_t fObjSize; // uncompressed basket size
+      Long64_t fEntry;   // entry being read
+   };
+
+private:
+   std::mutex fMutex;
+   std::vector<Event> fEvents;
+   std::map<std::thread::id, int> fThreadIds;
+   std::map<Long64_t, std::string> fBasketBranches; // basket offset -> branch
+
+   int GetThreadId()
+   {
+      // Requires fMutex.
+      auto res = fThreadIds.emplace(std::this_thread::get_id(), (int)fThreadIds.size());
+      return res.first->second;
+   }
+
+   void FillBasketBranches(TObjArray *branches)
+   {
+      for (Int_t i = 0; branches && i < branches->GetEntriesFast(); ++i) {
+         auto branch = static_cast<TBranch *>(branches->UncheckedAt(i));
+         for (Int_t b = 0; b < branch->GetWriteBasket(); ++b)
+            fBasketBranches[branch->GetBasketSeek(b)] = branch->GetName();
+         FillBasketBranches(branch->GetListOfBranches());
+      }
+   }
+
+public:
+   PerfStatsTrace(const char *name, TTree *tree) : TTreePerfStats(name, tree)
+   {
+      if (tree)
+         FillBasketBranches(tree->GetListOfBranches());
+   }
+
+   void FileReadEvent(TFile *file, Int_t len, Double_t start) override
+   {
+      TTreePerfStats::FileReadEvent(file, len, start);
+      double now = TTimeStamp().AsDouble();
+      std::lock_guard<std::mutex> lock(fMutex);
+      Long64_t entry = fTree ? fTree->GetReadEntry() : -1;
+      // the offset of the file points behind the data just read
+      fEvents.push_back({true, start, now - start, GetThreadId(), file->GetRelOffset() - len, len, 0, entry});
+   }
+
+   void UnzipEvent(TObject *tree, Long64_t pos, Double_t start, Int_t complen, Int_t objlen) override
+   {
+      TTreePerfStats::UnzipEvent(tree, pos, start, complen, objlen);
+      double now = TTimeStamp().AsDouble();
+      std::lock_guard<std::mutex> lock(fMutex);
+      Long64_t entry = fTree ? fTree->GetReadEntry() : -1;
+      fEvents.push_back({false, start, now - start, GetThreadId(), pos, complen, objlen, entry});
+   }
+
+   std::vector<Event> GetEvents()
+   {
+      std::lock_guard<std::mutex> lock(fMutex);
+      return fEvents;
+   }
+
+   const char *GetBasketBranch(Long64_t pos) const
+   {
+      auto iter = fBasketBranches.find(pos);
+      return iter == fBasketBranches.end() ? "" : iter->second.c_str();
+   }
+
+   bool SaveTrace(const char *filename)
+   {
+      // Write the events in the Chrome trace event format, times in us
+      // relative to the first event. Returns false if the file cannot be written.
+      FILE *out = fopen(filename, "w");
+      if (!out)
+         return false;
+      std::vector<Event> events = GetEvents();
+      double t0 = events.empty() ? 0. : events.front().fStart;
+      for (const Event &ev : events)
+         t0 = std::min(t0, ev.fStart);
+
+      fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+      fprintf(out, "  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"%s\"}}",
+              fFile ? fFile->GetName() : GetName());
+      for (const Event &ev : events) {
+         fprintf(out, ",\n  {\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, "
+                      "\"pid\": 1, \"tid\": %d, \"args\": {",
+                 ev.fIsRead ? "read" : GetBasketBranch(ev.fOffset), ev.fIsRead ? "read" : "unzip",
+                 (ev.fStart - t0) * 1e6, ev.fDuration * 1e6, ev.fThread);
+         if (ev.fIsRead)
+            fprintf(out, "\"offset\": %lld, \"bytes\": %lld, \"entry\": %lld}}", ev.fOffset, ev.fSize, ev.fEntry);
+         else
+            fprintf(out, "\"offset\": %lld, \"compressed\": %lld, \"uncompressed\": %lld, \"entry\": %lld}}",
+                    ev.fOffset, ev.fSize, ev.fObjSize, ev.fEntry);
+      }
+      fprintf(out, "\n]}\n");
+      return fclose(out) == 0;
+   }
+};
+
+#endif
@@ -0,0 +1,303 @@
+// Replays the reads of TTreeCache with different read strategies.
+//
+//    cacheReadBench [--cache-size=<kB>] [--gap=<kB>] file.root... [--benchmark_...]
+//
+// Reads the first tree of each file through TTreeCache, recording every
+// batch of segments that the cache passes to TFile::ReadBuffers. The batches
+// are then replayed on the file with
+//
+//    ROOT     TFile::ReadBuffers, i.e. the current path
+//    pread    one pread per segment
+//    merged   one pread per run of segments with gaps <= --gap, over-reads the gaps
+//    preadv   one preadv per such run, scattering into the segment buffers
+//
+// For every strategy the benchmark reports the wall time and, per replay of
+// all batches, the read syscalls and the bytes read beyond the requested
+// ones, as counted by the kernel in /proc/self/io. The page cache of the file
+// is dropped (POSIX_FADV_DONTNEED) before each replay, outside of the timing.
+// See scripts/pt_bench.h for the remaining options.
+
+#include "TClass.h"
+#include "TFile.h"
+#include "TKey.h"
+#include "TTree.h"
+
+#include "scripts/pt_bench.h"
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Segment {
+   Long64_t fPos;
+   Int_t fLen;
+};
+
+using Batch_t = std::vector<Segment>;
+
+// Records the batches of TTreeCache.
+class RecordingFile : public TFile {
+public:
+   std::vector<Batch_t> fBatches;
+
+   RecordingFile(const char *name) : TFile(name) {}
+
+   Bool_t ReadBuffers(char *buf, Long64_t *pos, Int_t *len, Int_t nbuf) override
+   {
+      Batch_t batch;
+      for (Int_t i = 0; i < nbuf; ++i)
+         batch.push_back({pos[i], len[i]});
+      fBatches.push_back(batch);
+      return TFile::ReadBuffers(buf, pos, len, nbuf);
+   }
+};
+
+struct IOCounters {
+   Long64_t fSyscalls = 0;
+   Long64_t fBytes = 0;
+};
+
+IOCounters ReadIOCounters()
+{
+   IOCounters counters;
+   std::ifstream io("/proc/self/io");
+   std::string key;
+   Long64_t value;
+   while (io >> key >> value) {
+      if (key == "syscr:")
+         counters.fSyscalls = value;
+      else if (key == "rchar:")
+         counters.fBytes = value;
+   }
+   return counters;
+}
+
+std::vector<Batch_t> RecordBatches(const std::string &filename, Long64_t cacheSize)
+{
+   std::vector<Batch_t> batches;
+   RecordingFile file(filename.c_str());
+   if (file.IsZombie())
+      return batches;
+   TTree *tree = nullptr;
+   for (TObject *obj : *file.GetListOfKeys()) {
+      auto key = static_cast<TKey *>(obj);
+      TClass *cl = TClass::GetClass(key->GetClassName());
+      if (cl && cl->InheritsFrom(TTree::Class())) {
+         tree = static_cast<TTree *>(key->ReadObj());
+         break;
+      }
+   }
+   if (!tree)
+      return batches;
+   file.fBatches.clear(); // drop the reads of the keys and of the tree header
+   tree->SetCacheSize(cacheSize);
+   tree->AddBranchToCache("*", kTRUE);
+   tree->StopCacheLearningPhase();
+   for (Long64_t i = 0; i < tree->GetEntries(); ++i)
+      tree->GetEntry(i);
+   batches.swap(file.fBatches);
+   delete tree;
+   return batches;
+}
+
+// Splits a sorted batch into runs of segments whose gaps are at most maxGap.
+std::vector<std::pair<size_t, size_t>> MergeRuns(const Batch_t &batch, Long64_t maxGap)
+{
+   std::vector<std::pair<size_t, size_t>> runs; // [first, last)
+   size_t first = 0;
+   for (size_t i = 1; i <= batch.size(); ++i) {
+      if (i == batch.size() || batch[i].fPos - (batch[i - 1].fPos + batch[i - 1].fLen) > maxGap ||
+          batch[i].fPos < batch[i - 1].fPos + batch[i - 1].fLen || i - first >= IOV_MAX / 2) {
+         runs.emplace_back(first, i);
+         first = i;
+      }
+   }
+   return runs;
+}
+
+enum class EStrategy { kROOT, kPread, kMerged, kPreadv };
+
+// Replays all batches once. Returns false on a read error.
+bool Replay(EStrategy strategy, int fd, TFile *file, std::vector<Batch_t> &batches, Long64_t maxGap,
+            std::vector<char> &buffer, std::vector<char> &scratch)
+{
+   for (Batch_t &batch : batches) {
+      Long64_t total = 0;
+      for (const Segment &seg : batch)
+         total += seg.fLen;
+      if ((Long64_t)buffer.size() < total)
+         buffer.resize(total);
+
+      switch (strategy) {
+      case EStrategy::kROOT: {
+         std::vector<Long64_t> pos;
+         std::vector<Int_t> len;
+         for (const Segment &seg : batch) {
+            pos.push_back(seg.fPos);
+            len.push_back(seg.fLen);
+         }
+         if (file->ReadBuffers(buffer.data(), pos.data(), len.data(), batch.size()))
+            return false; // kTRUE signals an error
+         break;
+      }
+      case EStrategy::kPread: {
+         char *out = buffer.data();
+         for (const Segment &seg : batch) {
+            if (pread(fd, out, seg.fLen, seg.fPos) != seg.fLen)
+               return false;
+            out += seg.fLen;
+         }
+         break;
+      }
+      case EStrategy::kMerged: {
+         char *out = buffer.data();
+         for (auto run : MergeRuns(batch, maxGap)) {
+            const Segment &first = batch[run.first], &last = batch[run.second - 1];
+            Long64_t length = last.fPos + last.fLen - first.fPos;
+            if ((Long64_t)scratch.size() < length)
+               scratch.resize(length);
+            if (pread(fd, scratch.data(), length, first.fPos) != length)
+               return false;
+            for (size_t i = run.first; i < run.second; ++i) {
+               memcpy(out, scratch.data() + (batch[i].fPos - first.fPos), batch[i].fLen);
+               out += batch[i].fLen;
+            }
+         }
+         break;
+      }
+      case EStrategy::kPreadv: {
+         char *out = buffer.data();
+         std::vector<iovec> iov;
+         for (auto run : MergeRuns(batch, maxGap)) {
+            iov.clear();
+            Long64_t length = 0;
+            for (size_t i = run.first; i < run.second; ++i) {
+               if (i > run.first) {
+                  Long64_t gap = batch[i].fPos - (batch[i - 1].fPos + batch[i - 1].fLen);
+                  if (gap > 0) {
+                     if ((Long64_t)scratch.size() < gap)
+                        scratch.resize(gap);
+                     iov.push_back({scratch.data(), (size_t)gap});
+                     length += gap;
+                  }
+               }
+               iov.push_back({out, (size_t)batch[i].fLen});
+               out += batch[i].fLen;
+               length += batch[i].fLen;
+            }
+            if (preadv(fd, iov.data(), iov.size(), batch[run.first].fPos) != length)
+               return false;
+         }
+         break;
+      }
+      }
+   }
+   return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+   PTBench::Runner runner(argc, argv);
+
+   // The cost of reading /proc/self/io itself.
+   const IOCounters probe0 = ReadIOCounters(), probe1 = ReadIOCounters();
+   const IOCounters probe = {probe1.fSyscalls - probe0.fSyscalls, probe1.fBytes - probe0.fBytes};
+
+   Long64_t cacheSize = 256 * 1024;
+   Long64_t maxGap = 64 * 1024;
+   std::vector<std::string> files;
+   for (int i = 1; i < argc; ++i) {
+      std::string arg(argv[i]);
+      if (arg.compare(0, 13, "--cache-size=") == 0)
+         cacheSize = atoll(arg.c_str() + 13) * 1024;
+      else if (arg.compare(0, 6, "--gap=") == 0)
+         maxGap = atoll(arg.c_str() + 6) * 1024;
+      else if (arg.compare(0, 2, "--") == 0) {
+         fprintf(stderr, "Usage: %s [--cache-size=<kB>] [--gap=<kB>] file.root... [--benchmark_...]\n", argv[0]);
+         return 2;
+      } else
+         files.push_back(arg);
+   }
+   if (files.empty()) {
+      fprintf(stderr, "%s: no input files\n", argv[0]);
+      return 2;
+   }
+
+   // Keep the recorded batches alive while the benchmarks run.
+   std::vector<std::unique_ptr<std::vector<Batch_t>>> patterns;
+   for (const std::string &filename : files) {
+      patterns.emplace_back(new std::vector<Batch_t>(RecordBatches(filename, cacheSize)));
+      std::vector<Batch_t> *batches = patterns.back().get();
+      if (batches->empty()) {
+         fprintf(stderr, "%s: no TTreeCache reads recorded for %s\n", argv[0], filename.c_str());
+         return 1;
+      }
+      Long64_t requested = 0, segments = 0;
+      for (const Batch_t &batch : *batches) {
+         segments += batch.size();
+         for (const Segment &seg : batch)
+            requested += seg.fLen;
+      }
+      const std::string base = filename.substr(filename.find_last_of('/') + 1);
+
+      const std::pair<const char *, EStrategy> strategies[] = {{"ROOT", EStrategy::kROOT},
+                                                               {"pread", EStrategy::kPread},
+                                                               {"merged", EStrategy::kMerged},
+                                                               {"preadv", EStrategy::kPreadv}};
+      for (auto strategy : strategies) {
+         EStrategy kind = strategy.second;
+         runner.Add(std::string(strategy.first) + "/" + base, [=](PTBench::State &state) {
+            int fd = open(filename.c_str(), O_RDONLY);
+            TFile *file = kind == EStrategy::kROOT ? TFile::Open(filename.c_str()) : nullptr;
+            if (fd < 0 || (kind == EStrategy::kROOT && !file)) {
+               state.SkipWithError("cannot open " + filename);
+               if (fd >= 0)
+                  close(fd);
+               return;
+            }
+            std::vector<char> buffer, scratch;
+            Long64_t syscalls = 0, bytes = 0;
+            while (state.KeepRunning()) {
+               state.PauseTiming();
+               posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+               IOCounters before = ReadIOCounters();
+               state.ResumeTiming();
+               bool ok = Replay(kind, fd, file, *batches, maxGap, buffer, scratch);
+               state.PauseTiming();
+               IOCounters after = ReadIOCounters();
+               syscalls += after.fSyscalls - before.fSyscalls - probe.fSyscalls;
+               bytes += after.fBytes - before.fBytes - probe.fBytes;
+               state.ResumeTiming();
+               if (!ok) {
+                  state.SkipWithError("read error in " + filename);
+                  break;
+               }
+            }
+            delete file;
+            close(fd);
+            const double n = state.iterations();
+            state.SetBytesProcessed(n * requested);
+            state.counters["batches"] = batches->size();
+            state.counters["segments"] = segments;
+            state.counters["syscalls"] = syscalls / n;
+            state.counters["over_read_bytes"] = std::max(0., bytes / n - requested);
+         });
+      }
+   }
+
+   return runner.Run();
+}
@@ -0,0 +1,170 @@
+// Single thread GetEntry throughput with parallel basket decompression.
+//
+//    unzipBench [--entries=N] [--max-workers=N] [--benchmark_...]
+//
+// Writes the Event tree of execperfstattest.C, split 2, with LZ4, ZLIB and
+// ZSTD into unzipBench_<algorithm>.root (one cluster per 20 entries) and
+// reads all entries back from one thread through
+//
+//    GetEntry/<algorithm>/serial      TTreeCache, decompression in GetEntry
+//    GetEntry/<algorithm>/workers:<n> TTreeCacheUnzip, the baskets of the
+//                                     cache are decompressed by the IMT pool
+//                                     of n threads ahead of GetEntry
+//
+// for n = 1, 2, 4, ... and --max-workers (default: all cores). Bytes/s are
+// uncompressed bytes; unzip_found and unzip_missed count the baskets that
+// were or were not decompressed in time. See scripts/pt_bench.h for the
+// remaining options.
+
+#include "TFile.h"
+#include "TRandom3.h"
+#include "TROOT.h"
+#include "TTree.h"
+#include "TTreeCacheUnzip.h"
+
+#include "Event.h"
+#include "scripts/pt_bench.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const Long64_t kCacheSize = 30000000;
+
+void WriteEventFile(const std::string &filename, int compression, Long64_t nentries)
+{
+   Event::Reset();
+   TFile file(filename.c_str(), "RECREATE", "", compression);
+   TTree *tree = new TTree("tree1", "Event tree");
+   tree->SetAutoFlush(20);
+   Event *event = new Event();
+   tree->Branch("event", &event, 8000, 2);
+   TRandom3 rnd(4357);
+   char etype[20];
+   for (Long64_t i = 0; i < nentries; ++i) {
+      Int_t ntrack = Int_t(600 + 600 * rnd.Landau(0, 1) / 120.);
+      Float_t random = rnd.Rndm();
+      snprintf(etype, 20, "type%d", Int_t(i / 5));
+      event->SetType(etype);
+      event->SetHeader(i, 200, 960312, random);
+      event->SetNseg(Int_t(10 * ntrack + 20 * rnd.Gaus(0, 1)));
+      event->SetNvertex(Int_t(1 + 20 * rnd.Rndm()));
+      event->SetFlag(UInt_t(random + 0.5));
+      event->SetTemperature(random + 20.);
+      for (UChar_t m = 0; m < 10; m++)
+         event->SetMeasure(m, Int_t(rnd.Gaus(m, m + 1)));
+      for (UChar_t j = 0; j < 4; j++)
+         for (UChar_t k = 0; k < 4; k++)
+            event->SetMatrix(j, k, rnd.Gaus(k * j, 1));
+      for (Int_t t = 0; t < ntrack; t++)
+         event->AddTrack(random);
+      tree->Fill();
+      event->Clear();
+   }
+   file.Write();
+   delete event;
+   Event::Reset();
+}
+
+// Reads all entries, with workers > 0 through TTreeCacheUnzip.
+void ReadEventFile(PTBench::State &state, const std::string &filename, int workers)
+{
+   if (workers > 0) {
+      ROOT::EnableImplicitMT(workers);
+      TTreeCacheUnzip::SetParallelUnzip(TTreeCacheUnzip::kForce);
+   } else {
+      TTreeCacheUnzip::SetParallelUnzip(TTreeCacheUnzip::kDisable);
+   }
+
+   double bytes = 0., entries = 0., found = 0., missed = 0.;
+   while (state.KeepRunning()) {
+      state.PauseTiming();
+      TFile *file = TFile::Open(filename.c_str());
+      TTree *tree = nullptr;
+      if (file)
+         file->GetObject("tree1", tree);
+      if (!tree) {
+         state.SkipWithError("cannot read tree1 from " + filename);
+         delete file;
+         break;
+      }
+      tree->SetImplicitMT(false); // measure GetEntry of one thread
+      tree->SetCacheSize(kCacheSize);
+      tree->AddBranchToCache("*", kTRUE);
+      tree->StopCacheLearningPhase();
+      auto unzip = dynamic_cast<TTreeCacheUnzip *>(file->GetCacheRead(tree));
+      if ((workers > 0) != (unzip != nullptr)) {
+         state.SkipWithError(workers > 0 ? "no TTreeCacheUnzip" : "unexpected TTreeCacheUnzip");
+         delete file;
+         break;
+      }
+      state.ResumeTiming();
+
+      const Long64_t nentries = tree->GetEntries();
+      for (Long64_t i = 0; i < nentries; ++i)
+         bytes += tree->GetEntry(i);
+
+      state.PauseTiming();
+      entries += nentries;
+      if (unzip) {
+         found += unzip->GetNFound();
+         missed += unzip->GetNMissed();
+      }
+      delete file;
+      state.ResumeTiming();
+   }
+
+   if (workers > 0)
+      ROOT::DisableImplicitMT();
+   TTreeCacheUnzip::SetParallelUnzip(TTreeCacheUnzip::kDisable);
+   state.SetBytesProcessed(bytes);
+   state.SetItemsProcessed(entries);
+   if (state.iterations()) {
+      state.counters["unzip_found"] = found / state.iterations();
+      state.counters["unzip_missed"] = missed / state.iterations();
+   }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+   PTBench::Runner runner(argc, argv);
+
+   Long64_t nentries = 200;
+   int maxWorkers = std::thread::hardware_concurrency();
+   for (int i = 1; i < argc; ++i) {
+      std::string arg(argv[i]);
+      if (arg.compare(0, 10, "--entries=") == 0)
+         nentries = atoll(arg.c_str() + 10);
+      else if (arg.compare(0, 14, "--max-workers=") == 0)
+         maxWorkers = atoi(arg.c_str() + 14);
+      else {
+         fprintf(stderr, "Usage: %s [--entries=N] [--max-workers=N] [--benchmark_...]\n", argv[0]);
+         return 2;
+      }
+   }
+   std::vector<int> workerCounts;
+   for (int workers = 1; workers < maxWorkers; workers *= 2)
+      workerCounts.push_back(workers);
+   workerCounts.push_back(std::max(1, maxWorkers));
+
+   const std::pair<const char *, int> algorithms[] = {{"LZ4", 404}, {"ZLIB", 101}, {"ZSTD", 505}};
+   for (auto algorithm : algorithms) {
+      const std::string filename = std::string("unzipBench_") + algorithm.first + ".root";
+      WriteEventFile(filename, algorithm.second, nentries);
+      const std::string prefix = std::string("GetEntry/") + algorithm.first;
+      runner.Add(prefix + "/serial", [filename](PTBench::State &state) { ReadEventFile(state, filename, 0); });
+      for (int workers : workerCounts) {
+         runner.Add(prefix + "/workers:" + std::to_string(workers),
+                    [filename, workers](PTBench::State &state) { ReadEventFile(state, filename, workers); });
+      }
+   }
+
+   return runner.Run();
+}
@@ -0,0 +1,400 @@
+#ifndef ROOTTEST_ROARINGENTRYLIST_H
+#define ROOTTEST_ROARINGENTRYLIST_H
+
+// A set of entry numbers of a tree or a chain as a roaring bitmap, for
+// combining selections.
+//
+// TEntryList keeps, per tree, blocks of 64000 entries that are bits or
+// indices, and has no intersection; Add and Subtract go through the blocks
+// of every sub list. Here the entries of the chain (global entry numbers)
+// are split by their high 48 bits into containers of 65536 entries, which
+// are a sorted array of the low 16 bits for at most 4096 entries and a
+// bitmap of 1024 words otherwise. Intersect, Add and Subtract walk the sorted
+// container keys of both lists and combine array with array by merging,
+// bitmap with bitmap word by word and array with bitmap by probing bits.
+//
+//    RoaringEntryList a = RoaringEntryList::FromTEntryList(*listA, &chain);
+//    RoaringEntryList b = RoaringEntryList::FromTEntryList(*listB, &chain);
+//    a.Intersect(b);                         // a AND b
+//    a.Subtract(vetoes);                     // a AND NOT vetoes
+//    TEntryList *sel = a.ToTEntryList(&chain); // for TChain::SetEntryList
+//
+// Entries are entered in any order, entering them in increasing order is
+// the fast path.
+
+#include "TChain.h"
+#include "TChainElement.h"
+#include "TEntryList.h"
+#include "TError.h"
+#include "TObjArray.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+class RoaringEntryList {
+private:
+   static constexpr UInt_t kMaxArray = 4096; // more entries are a bitmap
+   static constexpr UInt_t kWords = 1024;    // 65536 bits
+
+   struct Container {
+      std::vector<UShort_t> fArray; // sorted low bits, if not a bitmap
+      std::vector<ULong64_t> fBits; // kWords words, or empty
+      UInt_t fCard = 0;
+
+      bool IsBitmap() const { return !fBits.empty(); }
+      bool Test(UShort_t low) const
+      {
+         if (IsBitmap())
+            return fBits[low >> 6] >> (low & 63) & 1;
+         return std::binary_search(fArray.begin(), fArray.end(), low);
+      }
+      void Set(UShort_t low)
+      {
+         if (IsBitmap()) {
+            ULong64_t &word = fBits[low >> 6];
+            const ULong64_t bit = 1ULL << (low & 63);
+            fCard += !(word & bit);
+            word |= bit;
+            return;
+         }
+         if (fArray.empty() || low > fArray.back()) {
+            fArray.push_back(low);
+         } else {
+            auto it = std::lower_bound(fArray.begin(), fArray.end(), low);
+            if (*it == low)
+               return;
+            fArray.insert(it, low);
+         }
+         ++fCard;
+         if (fCard > kMaxArray)
+            ToBitmap();
+      }
+      void ToBitmap()
+      {
+         fBits.assign(kWords, 0);
+         for (UShort_t low : fArray)
+            fBits[low >> 6] |= 1ULL << (low & 63);
+         std::vector<UShort_t>().swap(fArray);
+      }
+      // Recounts a bitmap and turns it into an array if it has few entries.
+      void Shrink()
+      {
+         fCard = 0;
+         for (ULong64_t word : fBits)
+            fCard += std::bitset<64>(word).count();
+         if (fCard > kMaxArray)
+            return;
+         fArray.reserve(fCard);
+         ForEach([&](UShort_t low) { fArray.push_back(low); });
+         std::vector<ULong64_t>().swap(fBits);
+      }
+      template <typename F>
+      void ForEach(F &&f) const
+      {
+         if (!IsBitmap()) {
+            for (UShort_t low : fArray)
+               f(low);
+            return;
+         }
+         for (UInt_t w = 0; w < kWords; ++w) {
+            for (ULong64_t word = fBits[w]; word; word &= word - 1) {
+               const ULong64_t lowest = word & (~word + 1);
+               f(UShort_t(w * 64 + std::bitset<64>(lowest - 1).count()));
+            }
+         }
+      }
+   };
+
+   static void And(Container &a, const Container &b)
+   {
+      if (a.IsBitmap() && b.IsBitmap()) {
+         for (UInt_t w = 0; w < kWords; ++w)
+            a.fBits[w] &= b.fBits[w];
+         a.Shrink();
+         return;
+      }
+      std::vector<UShort_t> result;
+      if (!a.IsBitmap() && !b.IsBitmap()) {
+         std::set_intersection(a.fArray.begin(), a.fArray.end(), b.fArray.begin(), b.fArray.end(),
+                               std::back_inserter(result));
+      } else {
+         const Container &array = a.IsBitmap() ? b : a;
+         const Container &bitmap = a.IsBitmap() ? a : b;
+         for (UShort_t low : array.fArray) {
+            if (bitmap.Test(low))
+               result.push_back(low);
+         }
+      }
+      std::vector<ULong64_t>().swap(a.fBits);
+      a.fArray.swap(result);
+      a.fCard = a.fArray.size();
+   }
+
+   static void Or(Container &a, const Container &b)
+   {
+      if (!a.IsBitmap() && !b.IsBitmap() && a.fCard + b.fCard <= kMaxArray) {
+         std::vector<UShort_t> result;
+         std::set_union(a.fArray.begin(), a.fArray.end(), b.fArray.begin(), b.fArray.end(),
+                        std::back_inserter(result));
+         a.fArray.swap(result);
+         a.fCard = a.fArray.size();
+         return;
+      }
+      if (!a.IsBitmap())
+         a.ToBitmap();
+      if (b.IsBitmap()) {
+         for (UInt_t w = 0; w < kWords; ++w)
+            a.fBits[w] |= b.fBits[w];
+      } else {
+         for (UShort_t low : b.fArray)
+            a.fBits[low >> 6] |= 1ULL << (low & 63);
+      }
+      a.Shrink();
+   }
+
+   static void AndNot(Container &a, const Container &b)
+   {
+      if (a.IsBitmap()) {
+         if (b.IsBitmap()) {
+            for (UInt_t w = 0; w < kWords; ++w)
+               a.fBits[w] &= ~b.fBits[w];
+         } else {
+            for (UShort_t low : b.fArray)
+               a.fBits[low >> 6] &= ~(1ULL << (low & 63));
+         }
+         a.Shrink();
+         return;
+      }
+      std::vector<UShort_t> result;
+      if (b.IsBitmap()) {
+         for (UShort_t low : a.fArray) {
+            if (!b.Test(low))
+               result.push_back(low);
+         }
+      } else {
+         std::set_difference(a.fArray.begin(), a.fArray.end(), b.fArray.begin(), b.fArray.end(),
+                             std::back_inserter(result));
+      }
+      a.fArray.swap(result);
+      a.fCard = a.fArray.size();
+   }
+
+   std::vector<ULong64_t> fKeys; // entry >> 16 of the containers, sorted
+   std::vector<Container> fContainers;
+
+   void RemoveEmpty()
+   {
+      size_t n = 0;
+      for (size_t i = 0; i < fKeys.size(); ++i) {
+         if (fContainers[i].fCard == 0)
+            continue;
+         if (n != i) {
+            fKeys[n] = fKeys[i];
+            fContainers[n] = std::move(fContainers[i]);
+         }
+         ++n;
+      }
+      fKeys.resize(n);
+      fContainers.resize(n);
+   }
+
+   // The offset of every tree of the chain in it, and its entries at the end.
+   static std::vector<Long64_t> GetTreeOffsets(TChain &chain)
+   {
+      chain.GetEntries(); // offsets are known once the entries are
+      const Long64_t *offsets = chain.GetTreeOffset();
+      return std::vector<Long64_t>(offsets, offsets + chain.GetNtrees() + 1);
+   }
+
+public:
+   void Enter(Long64_t entry)
+   {
+      const ULong64_t key = ULong64_t(entry) >> 16;
+      const UShort_t low = entry & 0xffff;
+      if (fKeys.empty() || key > fKeys.back()) {
+         fKeys.push_back(key);
+         fContainers.emplace_back();
+         fContainers.back().Set(low);
+         return;
+      }
+      auto it = std::lower_bound(fKeys.begin(), fKeys.end(), key);
+      const size_t i = it - fKeys.begin();
+      if (*it != key) {
+         fKeys.insert(it, key);
+         fContainers.insert(fContainers.begin() + i, Container());
+      }
+      fContainers[i].Set(low);
+   }
+
+   // Enters the entries in [start, end).
+   void EnterRange(Long64_t start, Long64_t end)
+   {
+      for (Long64_t entry = start; entry < end; ++entry)
+         Enter(entry);
+   }
+
+   bool Contains(Long64_t entry) const
+   {
+      const ULong64_t key = ULong64_t(entry) >> 16;
+      auto it = std::lower_bound(fKeys.begin(), fKeys.end(), key);
+      return it != fKeys.end() && *it == key && fContainers[it - fKeys.begin()].Test(entry & 0xffff);
+   }
+
+   Long64_t GetN() const
+   {
+      Long64_t n = 0;
+      for (const Container &c : fContainers)
+         n += c.fCard;
+      return n;
+   }
+
+   // Bytes of the keys and of the arrays and bitmaps.
+   size_t GetBytes() const
+   {
+      size_t bytes = fKeys.capacity() * sizeof(ULong64_t) + fContainers.capacity() * sizeof(Container);
+      for (const Container &c : fContainers)
+         bytes += c.fArray.capacity() * sizeof(UShort_t) + c.fBits.capacity() * sizeof(ULong64_t);
+      return bytes;
+   }
+
+   // Calls f(entry) for the entries in increasing order.
+   template <typename F>
+   void ForEach(F &&f) const
+   {
+      for (size_t i = 0; i < fKeys.size(); ++i) {
+         const Long64_t high = Long64_t(fKeys[i]) << 16;
+         fContainers[i].ForEach([&](UShort_t low) { f(high | low); });
+      }
+   }
+
+   // Keeps the entries that are also in other.
+   void Intersect(const RoaringEntryList &other)
+   {
+      size_t j = 0;
+      for (size_t i = 0; i < fKeys.size(); ++i) {
+         while (j < other.fKeys.size() && other.fKeys[j] < fKeys[i])
+            ++j;
+         if (j < other.fKeys.size() && other.fKeys[j] == fKeys[i])
+            And(fContainers[i], other.fContainers[j]);
+         else
+            fContainers[i] = Container();
+      }
+      RemoveEmpty();
+   }
+
+   // Adds the entries of other.
+   void Add(const RoaringEntryList &other)
+   {
+      std::vector<ULong64_t> keys;
+      std::vector<Container> containers;
+      keys.reserve(fKeys.size() + other.fKeys.size());
+      containers.reserve(fKeys.size() + other.fKeys.size());
+      size_t i = 0, j = 0;
+      while (i < fKeys.size() || j < other.fKeys.size()) {
+         if (j == other.fKeys.size() || (i < fKeys.size() && fKeys[i] < other.fKeys[j])) {
+            keys.push_back(fKeys[i]);
+            containers.push_back(std::move(fContainers[i++]));
+         } else if (i == fKeys.size() || other.fKeys[j] < fKeys[i]) {
+            keys.push_back(other.fKeys[j]);
+            containers.push_back(other.fContainers[j++]);
+         } else {
+            keys.push_back(fKeys[i]);
+            containers.push_back(std::move(fContainers[i++]));
+            Or(containers.back(), other.fContainers[j++]);
+         }
+      }
+      fKeys.swap(keys);
+      fContainers.swap(containers);
+   }
+
+   // Removes the entries that are in other.
+   void Subtract(const RoaringEntryList &other)
+   {
+      size_t j = 0;
+      for (size_t i = 0; i < fKeys.size(); ++i) {
+         while (j < other.fKeys.size() && other.fKeys[j] < fKeys[i])
+            ++j;
+         if (j < other.fKeys.size() && other.fKeys[j] == fKeys[i])
+            AndNot(fContainers[i], other.fContainers[j]);
+      }
+      RemoveEmpty();
+   }
+
+   // The entries of list, in the chain if given: the entries of the sub list
+   // of each tree are shifted by the offset of the tree in the chain. Without
+   // a chain the entries are those of a list without sub lists.
+   static RoaringEntryList FromTEntryList(TEntryList &list, TChain *chain = nullptr)
+   {
+      RoaringEntryList result;
+      if (!chain || !list.GetLists()) {
+         const Long64_t n = list.GetN();
+         for (Long64_t i = 0; i < n; ++i)
+            result.Enter(list.GetEntry(i));
+         return result;
+      }
+      const std::vector<Long64_t> offsets = GetTreeOffsets(*chain);
+      TIter next(list.GetLists());
+      while (TEntryList *sub = static_cast<TEntryList *>(next())) {
+         Int_t tree = 0;
+         TIter nextElement(chain->GetListOfFiles());
+         while (TChainElement *element = static_cast<TChainElement *>(nextElement())) {
+            if (strcmp(element->GetName(), sub->GetTreeName()) == 0 &&
+                strcmp(element->GetTitle(), sub->GetFileName()) == 0)
+               break;
+            ++tree;
+         }
+         if (tree == chain->GetNtrees()) {
+            Error("RoaringEntryList::FromTEntryList", "%s in %s is not in the chain", sub->GetTreeName(),
+                  sub->GetFileName());
+            continue;
+         }
+         const Long64_t n = sub->GetN();
+         for (Long64_t i = 0; i < n; ++i)
+            result.Enter(offsets[tree] + sub->GetEntry(i));
+      }
+      return result;
+   }
+
+   // A TEntryList, owned by the caller, with the entries; with a sub list per
+   // tree holding entries if a chain is given.
+   TEntryList *ToTEntryList(TChain *chain = nullptr) const
+   {
+      TEntryList *list = new TEntryList();
+      if (!chain) {
+         ForEach([&](Long64_t entry) { list->Enter(entry); });
+         return list;
+      }
+      const std::vector<Long64_t> offsets = GetTreeOffsets(*chain);
+      const Int_t nTrees = chain->GetNtrees();
+      TEntryList sub;
+      Int_t tree = -1;
+      auto flush = [&] {
+         if (tree < 0)
+            return;
+         TChainElement *element = static_cast<TChainElement *>(chain->GetListOfFiles()->At(tree));
+         sub.SetTreeName(element->GetName());
+         sub.SetFileName(element->GetTitle());
+         list->AddSubList(&sub);
+         sub.Reset();
+      };
+      ForEach([&](Long64_t entry) {
+         if (tree == nTrees)
+            return; // beyond the chain
+         if (tree < 0 || entry >= offsets[tree + 1]) {
+            flush();
+            tree = std::upper_bound(offsets.begin(), offsets.end(), entry) - offsets.begin() - 1;
+            if (tree == nTrees)
+               return;
+         }
+         sub.Enter(entry - offsets[tree]);
+      });
+      if (tree < nTrees)
+         flush();
+      return list;
+   }
+};
+
+#endif
@@ -0,0 +1,257 @@
+// Combining selections of a chain with TEntryList and with RoaringEntryList.
+//
+//    roaringEntryListBench [--entries=N] [--trees=N] [--trials=N] [--skip-tentrylist]
+//
+// Builds a chain of --trees trees (default 100) with --entries entries in
+// total (default 1e9; the files are not needed, the chain is given the
+// entries of every tree) and three selections of it:
+//
+//    dense       half of the entries, at random
+//    sparse      one entry in 1000, at random
+//    clustered   runs of 100000 entries, three runs out of four
+//
+// as TEntryList, with a sub list per tree, and as RoaringEntryList. Then
+// combines every pair with AND (for TEntryList a - (a - b), it has no
+// intersection), OR (Add) and ANDNOT (Subtract), each on a copy of the first
+// selection, and reports the best time of --trials (default 1). The size of
+// the results is checked against a count over all entries, and the
+// conversions from and to TEntryList are checked on the dense selection.
+// --skip-tentrylist only runs RoaringEntryList.
+
+#include "TBufferFile.h"
+#include "TChain.h"
+#include "TEntryList.h"
+
+#include "RoaringEntryList.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+ULong64_t Mix(ULong64_t x)
+{
+   // splitmix64 finalizer
+   x += 0x9e3779b97f4a7c15ULL;
+   x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+   x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+   return x ^ (x >> 31);
+}
+
+struct Selection {
+   const char *fName;
+   bool (*fAccept)(Long64_t entry);
+   std::unique_ptr<TEntryList> fList;
+   RoaringEntryList fRoaring;
+};
+
+bool Dense(Long64_t entry)
+{
+   return Mix(entry) >> 63;
+}
+
+bool Sparse(Long64_t entry)
+{
+   return (Mix(entry) & 0xffffffff) % 1000 == 0;
+}
+
+bool Clustered(Long64_t entry)
+{
+   return (entry / 100000) % 4 != 0;
+}
+
+double Seconds(std::chrono::steady_clock::time_point start)
+{
+   return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The best time of f over trials calls.
+double Best(int trials, const std::function<void()> &f)
+{
+   double best = -1.;
+   for (int trial = 0; trial < trials; ++trial) {
+      auto start = std::chrono::steady_clock::now();
+      f();
+      const double seconds = Seconds(start);
+      if (best < 0 || seconds < best)
+         best = seconds;
+   }
+   return best;
+}
+
+std::unique_ptr<TEntryList> FillTEntryList(TChain &chain, bool (*accept)(Long64_t))
+{
+   std::unique_ptr<TEntryList> list(new TEntryList());
+   const Long64_t *offsets = chain.GetTreeOffset();
+   for (Int_t t = 0; t < chain.GetNtrees(); ++t) {
+      TEntryList sub;
+      TObject *element = chain.GetListOfFiles()->At(t);
+      sub.SetTreeName(element->GetName());
+      sub.SetFileName(element->GetTitle());
+      for (Long64_t entry = offsets[t]; entry < offsets[t + 1]; ++entry) {
+         if (accept(entry))
+            sub.Enter(entry - offsets[t]);
+      }
+      list->AddSubList(&sub);
+   }
+   return list;
+}
+
+double StreamedMB(TEntryList &list)
+{
+   TBufferFile buffer(TBuffer::kWrite);
+   buffer.WriteObject(&list);
+   return buffer.Length() / 1048576.;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+   Long64_t entries = 1000000000;
+   int trees = 100;
+   int trials = 1;
+   bool tentrylist = true;
+   for (int i = 1; i < argc; ++i) {
+      const char *arg = argv[i];
+      if (strncmp(arg, "--entries=", 10) == 0)
+         entries = atoll(arg + 10);
+      else if (strncmp(arg, "--trees=", 8) == 0)
+         trees = atoi(arg + 8);
+      else if (strncmp(arg, "--trials=", 9) == 0)
+         trials = atoi(arg + 9);
+      else if (strcmp(arg, "--skip-tentrylist") == 0)
+         tentrylist = false;
+      else {
+         fprintf(stderr, "Usage: %s [--entries=N] [--trees=N] [--trials=N] [--skip-tentrylist]\n", argv[0]);
+         return 2;
+      }
+   }
+   if (trees < 1 || entries < trees) {
+      fprintf(stderr, "Error: need at least one entry per tree\n");
+      return 2;
+   }
+
+   TChain chain("events");
+   for (int t = 0; t < trees; ++t) {
+      const Long64_t treeEntries = entries / trees + (t < entries % trees);
+      chain.Add(("roaringBench_" + std::to_string(t) + ".root?#events").c_str(), treeEntries);
+   }
+   if (chain.GetEntries() != entries) {
+      fprintf(stderr, "Error: the chain has %lld entries instead of %lld\n", chain.GetEntries(), entries);
+      return 1;
+   }
+
+   Selection selections[] = {{"dense", Dense, nullptr, {}},
+                             {"sparse", Sparse, nullptr, {}},
+                             {"clustered", Clustered, nullptr, {}}};
+   const int nSelections = sizeof(selections) / sizeof(selections[0]);
+
+   printf("%-10s %12s %12s %12s %14s %12s\n", "selection", "entries", "fill TEL (s)", "fill RB (s)", "TEL stream MB",
+          "RB MB");
+   for (Selection &s : selections) {
+      double fillList = 0.;
+      if (tentrylist) {
+         auto start = std::chrono::steady_clock::now();
+         s.fList = FillTEntryList(chain, s.fAccept);
+         fillList = Seconds(start);
+      }
+      auto start = std::chrono::steady_clock::now();
+      for (Long64_t entry = 0; entry < entries; ++entry) {
+         if (s.fAccept(entry))
+            s.fRoaring.Enter(entry);
+      }
+      const double fillRoaring = Seconds(start);
+      printf("%-10s %12lld %12.3f %12.3f %14.1f %12.1f\n", s.fName, s.fRoaring.GetN(), fillList, fillRoaring,
+             tentrylist ? StreamedMB(*s.fList) : 0., s.fRoaring.GetBytes() / 1048576.);
+   }
+
+   // Expected sizes of the combinations of every pair.
+   enum { kAnd, kOr, kAndNot, kOps };
+   const char *ops[] = {"AND", "OR", "ANDNOT"};
+   Long64_t expected[nSelections][nSelections][kOps] = {};
+   for (Long64_t entry = 0; entry < entries; ++entry) {
+      bool accepted[nSelections];
+      for (int s = 0; s < nSelections; ++s)
+         accepted[s] = selections[s].fAccept(entry);
+      for (int a = 0; a < nSelections; ++a) {
+         for (int b = a + 1; b < nSelections; ++b) {
+            expected[a][b][kAnd] += accepted[a] && accepted[b];
+            expected[a][b][kOr] += accepted[a] || accepted[b];
+            expected[a][b][kAndNot] += accepted[a] && !accepted[b];
+         }
+      }
+   }
+
+   int ret = 0;
+   printf("%-28s %12s %12s %12s %10s\n", "combination", "entries", "TEL (s)", "RB (s)", "speedup");
+   for (int a = 0; a < nSelections; ++a) {
+      for (int b = a + 1; b < nSelections; ++b) {
+         Selection &sa = selections[a];
+         Selection &sb = selections[b];
+         for (int op = 0; op < kOps; ++op) {
+            Long64_t nList = -1, nRoaring = -1;
+            double timeList = 0.;
+            if (tentrylist) {
+               timeList = Best(trials, [&] {
+                  TEntryList result(*sa.fList);
+                  if (op == kAnd) {
+                     TEntryList aNotB(*sa.fList);
+                     aNotB.Subtract(sb.fList.get());
+                     result.Subtract(&aNotB);
+                  } else if (op == kOr) {
+                     result.Add(sb.fList.get());
+                  } else {
+                     result.Subtract(sb.fList.get());
+                  }
+                  nList = result.GetN();
+               });
+            }
+            const double timeRoaring = Best(trials, [&] {
+               RoaringEntryList result(sa.fRoaring);
+               if (op == kAnd)
+                  result.Intersect(sb.fRoaring);
+               else if (op == kOr)
+                  result.Add(sb.fRoaring);
+               else
+                  result.Subtract(sb.fRoaring);
+               nRoaring = result.GetN();
+            });
+            const std::string name = std::string(sa.fName) + " " + ops[op] + " " + sb.fName;
+            if (tentrylist)
+               printf("%-28s %12lld %12.3f %12.3f %10.1f\n", name.c_str(), nRoaring, timeList, timeRoaring,
+                      timeList / timeRoaring);
+            else
+               printf("%-28s %12lld %12s %12.3f %10s\n", name.c_str(), nRoaring, "-", timeRoaring, "-");
+            const Long64_t n = expected[a][b][op];
+            if (nRoaring != n || (tentrylist && nList != n)) {
+               fprintf(stderr, "Error: %s has %lld entries in TEntryList, %lld in RoaringEntryList, expected %lld\n",
+                       name.c_str(), nList, nRoaring, n);
+               ret = 1;
+            }
+         }
+      }
+   }
+
+   if (tentrylist) {
+      Selection &dense = selections[0];
+      RoaringEntryList converted;
+      const double from = Best(1, [&] { converted = RoaringEntryList::FromTEntryList(*dense.fList, &chain); });
+      std::unique_ptr<TEntryList> back;
+      const double to = Best(1, [&] { back.reset(converted.ToTEntryList(&chain)); });
+      printf("dense from TEntryList: %.3f s, to TEntryList: %.3f s\n", from, to);
+      RoaringEntryList difference(converted);
+      difference.Subtract(dense.fRoaring);
+      if (converted.GetN() != dense.fRoaring.GetN() || difference.GetN() != 0 || back->GetN() != dense.fList->GetN()) {
+         fprintf(stderr, "Error: the conversions of the dense selection lose or add entries\n");
+         ret = 1;
+      }
+   }
+   return ret;
+}
@@ -0,0 +1,243 @@
+// Read performance of the basket orders of TTree::CloneTree("fast").
+//
+//    sortBasketsBench [--entries=N] [--trials=N] [--keep]
+//
+// Replaces run_test.sh: writes an Event like tree (a header of scalars and
+// per track vectors, on average 600 tracks per event) of --entries events
+// (default 4000) into sortBaskets_Orig.root and fast clones it with each of
+//
+//    ByOffset   baskets in the order of their offset in the input file
+//    ByEntry    baskets in the order of their first entry
+//    ByBranch   all baskets of a branch together
+//
+// into sortBaskets_<layout>.root. Each layout is then read --trials times
+// (default 3) through the default TTreeCache, once reading all branches and
+// once only px. Reports the best time, the read calls and the seeks, i.e.
+// the reads not starting where the previous one ended, and names the layout
+// with the fewest seeks for each pattern. Reads are served by the page
+// cache, so the seeks, not the times, tell what the layout would cost on a
+// disk or a remote file.
+
+#include "TFile.h"
+#include "TRandom3.h"
+#include "TTree.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+// A TFile counting its reads and seeks.
+class SeekCountingFile : public TFile {
+private:
+   Long64_t fPos = -1;
+   Long64_t fSeeks = 0;
+   Long64_t fReads = 0;
+
+protected:
+   Long64_t SysSeek(Int_t fd, Long64_t offset, Int_t whence) override
+   {
+      Long64_t pos = TFile::SysSeek(fd, offset, whence);
+      if (pos != fPos)
+         ++fSeeks;
+      fPos = pos;
+      return pos;
+   }
+
+   Int_t SysRead(Int_t fd, void *buf, Int_t len) override
+   {
+      Int_t n = TFile::SysRead(fd, buf, len);
+      ++fReads;
+      if (n > 0)
+         fPos += n;
+      return n;
+   }
+
+public:
+   explicit SeekCountingFile(const char *filename) : TFile(filename) {}
+
+   void ResetCounts()
+   {
+      fSeeks = 0;
+      fReads = 0;
+   }
+   Long64_t GetSeeks() const { return fSeeks; }
+   Long64_t GetReads() const { return fReads; }
+};
+
+struct ReadResult {
+   double fSeconds = -1.;
+   Long64_t fReads = 0;
+   Long64_t fSeeks = 0;
+   double fSumPx = 0.;
+};
+
+void WriteEventTree(const char *filename, Long64_t entries)
+{
+   TFile f(filename, "RECREATE");
+   TTree t("T", "Event like tree");
+   Int_t run, event, ntrack, flag;
+   Float_t temperature;
+   std::vector<float> px, py, pz, energy;
+   std::vector<int> charge, nhits;
+   t.Branch("run", &run, "run/I");
+   t.Branch("event", &event, "event/I");
+   t.Branch("ntrack", &ntrack, "ntrack/I");
+   t.Branch("flag", &flag, "flag/I");
+   t.Branch("temperature", &temperature, "temperature/F");
+   t.Branch("px", &px);
+   t.Branch("py", &py);
+   t.Branch("pz", &pz);
+   t.Branch("energy", &energy);
+   t.Branch("charge", &charge);
+   t.Branch("nhits", &nhits);
+   TRandom3 rnd(4357);
+   for (Long64_t i = 0; i < entries; ++i) {
+      run = 200;
+      event = i;
+      ntrack = Int_t(600 + 600 * rnd.Landau(0, 1) / 120.);
+      flag = rnd.Rndm() > 0.5;
+      temperature = 20. + rnd.Rndm();
+      px.resize(ntrack);
+      py.resize(ntrack);
+      pz.resize(ntrack);
+      energy.resize(ntrack);
+      charge.resize(ntrack);
+      nhits.resize(ntrack);
+      for (Int_t k = 0; k < ntrack; ++k) {
+         rnd.Rannor(px[k], py[k]);
+         pz[k] = rnd.Gaus(0, 1);
+         energy[k] = std::sqrt(px[k] * px[k] + py[k] * py[k] + pz[k] * pz[k] + 0.019);
+         charge[k] = rnd.Rndm() > 0.5 ? 1 : -1;
+         nhits[k] = Int_t(rnd.Gaus(20, 4));
+      }
+      t.Fill();
+   }
+   t.Write();
+}
+
+bool FastClone(const char *input, const std::string &output, const std::string &layout)
+{
+   TFile in(input);
+   TTree *from = nullptr;
+   in.GetObject("T", from);
+   if (!from)
+      return false;
+   TFile out(output.c_str(), "RECREATE");
+   TTree *clone = from->CloneTree(-1, ("fast SortBaskets" + layout).c_str());
+   if (!clone || clone->GetEntries() != from->GetEntries())
+      return false;
+   out.Write();
+   return true;
+}
+
+ReadResult Read(const std::string &filename, bool onlyPx)
+{
+   ReadResult result;
+   SeekCountingFile f(filename.c_str());
+   TTree *t = nullptr;
+   if (!f.IsZombie())
+      f.GetObject("T", t);
+   if (!t)
+      return result;
+   std::vector<float> *px = nullptr;
+   if (onlyPx) {
+      t->SetBranchStatus("*", false);
+      t->SetBranchStatus("px", true);
+   }
+   t->SetBranchAddress("px", &px);
+   f.ResetCounts();
+   auto start = std::chrono::steady_clock::now();
+   const Long64_t entries = t->GetEntries();
+   for (Long64_t i = 0; i < entries; ++i) {
+      t->GetEntry(i);
+      for (float x : *px)
+         result.fSumPx += x;
+   }
+   result.fSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   result.fReads = f.GetReads();
+   result.fSeeks = f.GetSeeks();
+   t->ResetBranchAddresses();
+   delete px;
+   return result;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+   Long64_t entries = 4000;
+   int trials = 3;
+   bool keep = false;
+   for (int i = 1; i < argc; ++i) {
+      const char *arg = argv[i];
+      if (strncmp(arg, "--entries=", 10) == 0)
+         entries = atoll(arg + 10);
+      else if (strncmp(arg, "--trials=", 9) == 0)
+         trials = atoi(arg + 9);
+      else if (strcmp(arg, "--keep") == 0)
+         keep = true;
+      else {
+         fprintf(stderr, "Usage: %s [--entries=N] [--trials=N] [--keep]\n", argv[0]);
+         return 2;
+      }
+   }
+
+   const char *orig = "sortBaskets_Orig.root";
+   WriteEventTree(orig, entries);
+   const char *layouts[] = {"Orig", "ByOffset", "ByEntry", "ByBranch"};
+   const char *patterns[] = {"all branches", "px only"};
+   int ret = 0;
+   for (const char *layout : layouts) {
+      if (strcmp(layout, "Orig") != 0 &&
+          !FastClone(orig, std::string("sortBaskets_") + layout + ".root", layout)) {
+         fprintf(stderr, "Error: cannot fast clone with SortBaskets%s\n", layout);
+         return 1;
+      }
+   }
+
+   printf("%-10s %-14s %10s %10s %10s\n", "layout", "read", "time (s)", "reads", "seeks");
+   double sumPx = 0.;
+   for (int p = 0; p < 2; ++p) {
+      const char *best = nullptr;
+      Long64_t bestSeeks = 0;
+      for (const char *layout : layouts) {
+         const std::string filename = std::string("sortBaskets_") + layout + ".root";
+         ReadResult best1;
+         for (int trial = 0; trial < trials; ++trial) {
+            ReadResult res = Read(filename, p == 1);
+            if (res.fSeconds < 0) {
+               fprintf(stderr, "Error: cannot read %s\n", filename.c_str());
+               return 1;
+            }
+            if (best1.fSeconds < 0 || res.fSeconds < best1.fSeconds)
+               best1 = res;
+         }
+         printf("%-10s %-14s %10.3f %10lld %10lld\n", layout, patterns[p], best1.fSeconds, best1.fReads,
+                best1.fSeeks);
+         if (!best || best1.fSeeks < bestSeeks) {
+            best = layout;
+            bestSeeks = best1.fSeeks;
+         }
+         if (p == 0 && layout == layouts[0])
+            sumPx = best1.fSumPx;
+         else if (std::abs(best1.fSumPx - sumPx) > 1e-6 * (std::abs(sumPx) + 1.)) {
+            fprintf(stderr, "Error: %s reads a different sum of px: %g vs %g\n", filename.c_str(), best1.fSumPx,
+                    sumPx);
+            ret = 1;
+         }
+      }
+      printf("fewest seeks reading %s: %s\n", patterns[p], best);
+   }
+
+   if (!keep) {
+      for (const char *layout : layouts)
+         remove((std::string("sortBaskets_") + layout + ".root").c_str());
+   }
+   return ret;
+}
@@ -0,0 +1,171 @@
+#ifndef ROOTTEST_INDEXEDFRIENDREADER_H
+#define ROOTTEST_INDEXEDFRIENDREADER_H
+
+// Reading a friend tree matched through a TTreeIndex, one cluster of the main
+// tree at a time.
+//
+// A friend with an index, added with AddFriend, is read at the entry
+// matching every entry of the main tree. When the friend is not in the order
+// of the main tree, every entry needs another basket of the friend, read and
+// decompressed again and again. Here, when an entry of a new cluster of the
+// main tree is asked for, the friend entries of the whole cluster are looked
+// up in the index, sorted, and the branches added are read for those entries
+// in increasing order through a TTreeCache of the friend, so that every
+// basket is read once per cluster. The values are kept until the next
+// cluster and GetEntry only copies them.
+//
+//    TTree *calib;              // not a friend of events
+//    calib->BuildIndex("run", "event");
+//    IndexedFriendReader reader(events, calib, "run", "event");
+//    const float *gain = reader.Add<float>("gain");
+//    for (Long64_t i = 0; i < events->GetEntries(); ++i) {
+//       events->GetEntry(i);
+//       if (reader.GetEntry(i))
+//          use(*gain);
+//    }
+//
+// major and minor are evaluated in the main tree; the index of the friend is
+// built from them if it has none. Only branches holding one value of a
+// fundamental type can be added, and both trees must be TTrees, not chains.
+
+#include "TBranch.h"
+#include "TError.h"
+#include "TTree.h"
+#include "TTreeFormula.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+class IndexedFriendReader {
+private:
+   struct ColumnBase {
+      TBranch *fBranch = nullptr;
+      virtual ~ColumnBase() = default;
+      virtual void Resize(size_t n) = 0;
+      virtual void Read(Long64_t friendEntry, size_t slot) = 0;
+      virtual void Set(Long64_t slot) = 0; // -1 for no friend entry
+   };
+
+   template <typename T>
+   struct Column : ColumnBase {
+      T fBuffer{};
+      T fValue{};
+      std::vector<T> fValues; // per friend entry of the cluster
+      void Resize(size_t n) override { fValues.resize(n); }
+      void Read(Long64_t friendEntry, size_t slot) override
+      {
+         fBranch->GetEntry(friendEntry);
+         fValues[slot] = fBuffer;
+      }
+      void Set(Long64_t slot) override { fValue = slot < 0 ? T() : fValues[slot]; }
+   };
+
+   TTree *fMain;
+   TTree *fFriend;
+   std::unique_ptr<TTreeFormula> fMajor;
+   std::unique_ptr<TTreeFormula> fMinor;
+   std::vector<std::unique_ptr<ColumnBase>> fColumns;
+
+   Long64_t fStart = -1; // of the cluster read
+   Long64_t fEnd = -1;
+   std::vector<Long64_t> fSlots;         // per entry of the cluster, -1 without friend entry
+   std::vector<Long64_t> fFriendEntries; // of the cluster, sorted
+   Long64_t fFriendEntry = -1;
+
+   void ReadCluster(Long64_t entry)
+   {
+      TTree::TClusterIterator clusters = fMain->GetClusterIterator(entry);
+      fStart = clusters();
+      fEnd = std::min(clusters.GetNextEntry(), fMain->GetEntries());
+
+      // Friend entry of every entry of the cluster.
+      const Long64_t readEntry = fMain->GetReadEntry();
+      std::vector<Long64_t> matches(fEnd - fStart);
+      for (Long64_t i = fStart; i < fEnd; ++i) {
+         fMain->LoadTree(i);
+         matches[i - fStart] = fFriend->GetEntryNumberWithIndex(fMajor->EvalInstance64(), fMinor->EvalInstance64());
+      }
+      // The formulas loaded the major and minor branches, and so the user's
+      // addresses, at the entries of the cluster: load them back.
+      if (readEntry >= 0) {
+         fMain->LoadTree(readEntry);
+         fMajor->EvalInstance64();
+         fMinor->EvalInstance64();
+      }
+
+      fFriendEntries = matches;
+      std::sort(fFriendEntries.begin(), fFriendEntries.end());
+      fFriendEntries.erase(std::unique(fFriendEntries.begin(), fFriendEntries.end()), fFriendEntries.end());
+      if (!fFriendEntries.empty() && fFriendEntries.front() < 0)
+         fFriendEntries.erase(fFriendEntries.begin());
+      fSlots.resize(matches.size());
+      for (size_t i = 0; i < matches.size(); ++i) {
+         fSlots[i] = matches[i] < 0 ? -1
+                                    : std::lower_bound(fFriendEntries.begin(), fFriendEntries.end(), matches[i]) -
+                                         fFriendEntries.begin();
+      }
+
+      // Read the friend in increasing entry order.
+      for (auto &column : fColumns)
+         column->Resize(fFriendEntries.size());
+      for (size_t slot = 0; slot < fFriendEntries.size(); ++slot) {
+         fFriend->LoadTree(fFriendEntries[slot]); // moves the TTreeCache
+         for (auto &column : fColumns)
+            column->Read(fFriendEntries[slot], slot);
+      }
+   }
+
+public:
+   IndexedFriendReader(TTree *main, TTree *friendTree, const char *major, const char *minor = "0")
+      : fMain(main),
+        fFriend(friendTree),
+        fMajor(new TTreeFormula("major", major, main)),
+        fMinor(new TTreeFormula("minor", minor, main))
+   {
+      if (!fFriend->GetTreeIndex())
+         fFriend->BuildIndex(major, minor);
+      fFriend->SetCacheSize(); // the default size
+   }
+
+   // The value of the branch for the friend entry of the last GetEntry. Add
+   // all the branches before the first GetEntry, or the cluster is read again.
+   template <typename T>
+   const T *Add(const char *branchName)
+   {
+      TBranch *branch = fFriend->GetBranch(branchName);
+      if (!branch) {
+         Error("IndexedFriendReader::Add", "%s has no branch %s", fFriend->GetName(), branchName);
+         return nullptr;
+      }
+      auto column = new Column<T>();
+      column->fBranch = branch;
+      if (fFriend->SetBranchAddress(branchName, &column->fBuffer) < 0) {
+         delete column;
+         return nullptr;
+      }
+      fColumns.emplace_back(column);
+      fFriend->AddBranchToCache(branch);
+      fFriend->StopCacheLearningPhase();
+      fStart = fEnd = -1;
+      return &column->fValue;
+   }
+
+   // Sets the values of the friend entry matching the entry of the main
+   // tree. Returns false, and default values, if the friend has none.
+   bool GetEntry(Long64_t entry)
+   {
+      if (entry < fStart || entry >= fEnd)
+         ReadCluster(entry);
+      const Long64_t slot = fSlots[entry - fStart];
+      fFriendEntry = slot < 0 ? -1 : fFriendEntries[slot];
+      for (auto &column : fColumns)
+         column->Set(slot);
+      return slot >= 0;
+   }
+
+   // The friend entry of the last GetEntry, -1 if there is none.
+   Long64_t GetFriendEntry() const { return fFriendEntry; }
+};
+
+#endif
@@ -0,0 +1,230 @@
+// Reading an unaligned friend matched through a TTreeIndex, with AddFriend
+// and with IndexedFriendReader.
+//
+//    indexedFriendBench [--entries=N] [--branches=N] [--cluster=N] [--keep]
+//
+// Writes a main tree "events" of --entries entries (default 100000), in
+// clusters of --cluster entries (default 10000), with run, event and x, and a
+// calibration tree "calib" with the same (run, event) in a random order and
+// --branches float branches (default 8). Then reads every entry of events
+//
+//    main only             events alone, for reference
+//    AddFriend             with calib as a friend indexed by (run, event)
+//    IndexedFriendReader   with the calib values of each cluster of events
+//                          read in the order of calib
+//
+// and reports the time and the bytes and read calls of the calib file. Fails
+// if the two ways of reading calib do not give the same sum of its values, or
+// if run and event of events do not hold the values of the entry read.
+
+#include "TFile.h"
+#include "TTree.h"
+
+#include "IndexedFriendReader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char *kMainFile = "indexedFriend_events.root";
+const char *kCalibFile = "indexedFriend_calib.root";
+const Int_t kEventsPerRun = 10000;
+
+struct ReadResult {
+   double fSeconds = -1.;
+   Long64_t fCalibBytes = 0;
+   Int_t fCalibReads = 0;
+   double fSum = 0.;
+   Long64_t fMissing = 0;
+   Long64_t fWrongKeys = 0; // entries with run or event of another entry
+};
+
+float CalibValue(Int_t run, Int_t event, int branch)
+{
+   return 0.001f * ((run * 7 + event) % 1000) + branch;
+}
+
+bool WriteTrees(Long64_t entries, int branches, Long64_t cluster)
+{
+   {
+      TFile f(kMainFile, "RECREATE");
+      if (f.IsZombie())
+         return false;
+      TTree t("events", "");
+      Int_t run, event;
+      Float_t x;
+      t.Branch("run", &run, "run/I");
+      t.Branch("event", &event, "event/I");
+      t.Branch("x", &x, "x/F");
+      t.SetAutoFlush(cluster);
+      for (Long64_t i = 0; i < entries; ++i) {
+         run = 1 + i / kEventsPerRun;
+         event = i % kEventsPerRun;
+         x = 0.5f * (i % 17);
+         t.Fill();
+      }
+      f.Write();
+   }
+   TFile f(kCalibFile, "RECREATE");
+   if (f.IsZombie())
+      return false;
+   TTree t("calib", "");
+   Int_t run, event;
+   std::vector<Float_t> c(branches);
+   t.Branch("run", &run, "run/I");
+   t.Branch("event", &event, "event/I");
+   for (int b = 0; b < branches; ++b)
+      t.Branch(("c" + std::to_string(b)).c_str(), &c[b], ("c" + std::to_string(b) + "/F").c_str());
+   std::vector<Long64_t> order(entries);
+   std::iota(order.begin(), order.end(), 0);
+   std::shuffle(order.begin(), order.end(), std::mt19937_64(4357));
+   for (Long64_t i : order) {
+      run = 1 + i / kEventsPerRun;
+      event = i % kEventsPerRun;
+      for (int b = 0; b < branches; ++b)
+         c[b] = CalibValue(run, event, b);
+      t.Fill();
+   }
+   t.BuildIndex("run", "event");
+   f.Write();
+   return true;
+}
+
+// mode 0: main only, 1: AddFriend, 2: IndexedFriendReader
+ReadResult Read(int mode, int branches)
+{
+   ReadResult result;
+   TFile mainFile(kMainFile);
+   TFile calibFile(kCalibFile);
+   TTree *events = nullptr, *calib = nullptr;
+   mainFile.GetObject("events", events);
+   calibFile.GetObject("calib", calib);
+   if (!events || !calib)
+      return result;
+   Float_t x;
+   Int_t run, event;
+   events->SetBranchAddress("x", &x);
+   events->SetBranchAddress("run", &run);
+   events->SetBranchAddress("event", &event);
+
+   std::vector<Float_t> c(branches);
+   std::vector<const Float_t *> values(branches);
+   std::unique_ptr<IndexedFriendReader> reader;
+   if (mode == 1) {
+      events->AddFriend(calib);
+      calib->SetBranchStatus("run", false); // matched through the index
+      calib->SetBranchStatus("event", false);
+      for (int b = 0; b < branches; ++b) {
+         calib->SetBranchAddress(("c" + std::to_string(b)).c_str(), &c[b]);
+         values[b] = &c[b];
+      }
+   } else if (mode == 2) {
+      reader.reset(new IndexedFriendReader(events, calib, "run", "event"));
+      for (int b = 0; b < branches; ++b)
+         values[b] = reader->Add<Float_t>(("c" + std::to_string(b)).c_str());
+   }
+
+   auto start = std::chrono::steady_clock::now();
+   const Long64_t entries = events->GetEntries();
+   for (Long64_t i = 0; i < entries; ++i) {
+      events->GetEntry(i);
+      result.fSum += x;
+      if (mode == 1 && calib->GetReadEntry() < 0)
+         ++result.fMissing;
+      else if (mode == 2 && !reader->GetEntry(i))
+         ++result.fMissing;
+      else if (mode != 0) {
+         for (const Float_t *value : values)
+            result.fSum += *value;
+      }
+      if (run != 1 + i / kEventsPerRun || event != i % kEventsPerRun)
+         ++result.fWrongKeys;
+   }
+   result.fSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   result.fCalibBytes = calibFile.GetBytesRead();
+   result.fCalibReads = calibFile.GetReadCalls();
+   if (mode == 1)
+      events->RemoveFriend(calib);
+   return result;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+   Long64_t entries = 100000;
+   int branches = 8;
+   Long64_t cluster = 10000;
+   bool keep = false;
+   for (int i = 1; i < argc; ++i) {
+      const char *arg = argv[i];
+      if (strncmp(arg, "--entries=", 10) == 0)
+         entries = atoll(arg + 10);
+      else if (strncmp(arg, "--branches=", 11) == 0)
+         branches = atoi(arg + 11);
+      else if (strncmp(arg, "--cluster=", 10) == 0)
+         cluster = atoll(arg + 10);
+      else if (strcmp(arg, "--keep") == 0)
+         keep = true;
+      else {
+         fprintf(stderr, "Usage: %s [--entries=N] [--branches=N] [--cluster=N] [--keep]\n", argv[0]);
+         return 2;
+      }
+   }
+   if (entries < 1 || branches < 1 || cluster < 1) {
+      fprintf(stderr, "Error: entries, branches and cluster must be positive\n");
+      return 2;
+   }
+   if (!WriteTrees(entries, branches, cluster)) {
+      fprintf(stderr, "Error: cannot write %s or %s\n", kMainFile, kCalibFile);
+      return 1;
+   }
+
+   const char *modes[] = {"main only", "AddFriend", "IndexedFriendReader"};
+   ReadResult results[3];
+   printf("%-20s %10s %14s %12s\n", "read", "time (s)", "calib bytes", "calib reads");
+   for (int mode = 0; mode < 3; ++mode) {
+      results[mode] = Read(mode, branches);
+      if (results[mode].fSeconds < 0) {
+         fprintf(stderr, "Error: cannot read %s or %s\n", kMainFile, kCalibFile);
+         return 1;
+      }
+      printf("%-20s %10.3f %14lld %12d\n", modes[mode], results[mode].fSeconds, results[mode].fCalibBytes,
+             results[mode].fCalibReads);
+   }
+
+   int ret = 0;
+   if (results[1].fMissing || results[2].fMissing) {
+      fprintf(stderr, "Error: calib entries not found: %lld with AddFriend, %lld with IndexedFriendReader\n",
+              results[1].fMissing, results[2].fMissing);
+      ret = 1;
+   }
+   for (int mode = 0; mode < 3; ++mode) {
+      if (results[mode].fWrongKeys) {
+         fprintf(stderr, "Error: %s: run or event of another entry for %lld entries\n", modes[mode],
+                 results[mode].fWrongKeys);
+         ret = 1;
+      }
+   }
+   if (std::abs(results[1].fSum - results[2].fSum) > 1e-9 * std::abs(results[1].fSum)) {
+      fprintf(stderr, "Error: the sums differ: %.10g with AddFriend, %.10g with IndexedFriendReader\n",
+              results[1].fSum, results[2].fSum);
+      ret = 1;
+   }
+
+   if (!keep) {
+      remove(kMainFile);
+      remove(kCalibFile);
+   }
+   return ret;
+}
@@ -0,0 +1,334 @@
+#ifndef ROOTTEST_HASHINDEX_H
+#define ROOTTEST_HASHINDEX_H
+
+// Index of the entries of a chain by (major, minor), e.g. (run, event),
+// persisted next to every file and memory mapped on reopen.
+//
+// TChain::BuildIndex reads the major and minor values of every tree at
+// every start, keeps three Long64_t (24 bytes) per entry in sorted arrays and
+// must load the TTreeIndex of every tree. Here the index of every file is an
+// open addressing hash table with Robin Hood hashing, filled to 7/8, of 12
+// byte slots (major, minor and the entry in the file, 32 bits each), i.e.
+// about 14 bytes per entry. The tables are built in parallel for all files
+// and written to <file>.hidx; a file whose .hidx is newer than the file and
+// was built for the same tree, major and minor is not indexed again. Opening
+// the index of a chain only maps the .hidx files; their pages are loaded on
+// demand and shared by the processes using them.
+//
+//    HashIndex::Build(files, "events", "run", "event", 8);
+//    HashIndex index(files);
+//    Long64_t entry = index.GetEntryNumberWithIndex(run, event); // in the chain
+//
+// Major and minor are TTreeFormula expressions, as for BuildIndex, whose
+// values must be in [0, 2^32), and a file can have at most 3.7e9 entries.
+// For duplicated keys the first entry is kept.
+// A lookup only probes the files whose range of major values contains the
+// major searched, i.e. usually one or a few for files ordered by run.
+
+#include "TError.h"
+#include "TFile.h"
+#include "TROOT.h"
+#include "TSystem.h"
+#include "TTree.h"
+#include "TTreeFormula.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+class HashIndex {
+public:
+   struct Slot {
+      UInt_t fMajor;
+      UInt_t fMinor;
+      UInt_t fEntry; // in the file, kEmpty if the slot is empty
+   };
+
+   struct Header {
+      char fMagic[8];
+      ULong64_t fSignature; // of the tree name, major and minor
+      ULong64_t fCapacity;
+      ULong64_t fKeys;
+      Long64_t fEntries; // of the tree
+      ULong64_t fMinMajor;
+      ULong64_t fMaxMajor;
+   };
+
+   static constexpr UInt_t kEmpty = 0xffffffff;
+   static constexpr Long64_t kMaxEntries = 0xE0000000LL; // (hash >> 32) * capacity fits in 64 bits
+
+private:
+   struct Table {
+      void *fMap = nullptr;
+      size_t fBytes = 0;
+      const Header *fHeader = nullptr;
+      const Slot *fSlots = nullptr;
+      Long64_t fOffset = 0; // of the first entry of the file in the chain
+   };
+
+   std::vector<Table> fTables;
+   Long64_t fEntries = 0;
+
+   static constexpr const char *kMagic = "RTHIDX2";
+
+   static ULong64_t Hash(UInt_t major, UInt_t minor)
+   {
+      // splitmix64 finalizer
+      ULong64_t key = ULong64_t(major) << 32 | minor;
+      key ^= key >> 30;
+      key *= 0xbf58476d1ce4e5b9ULL;
+      key ^= key >> 27;
+      key *= 0x94d049bb133111ebULL;
+      return key ^ (key >> 31);
+   }
+
+   // The first slot to probe, in [0, capacity).
+   static ULong64_t Home(ULong64_t hash, ULong64_t capacity) { return ((hash >> 32) * capacity) >> 32; }
+
+   // How far the slot i is from the home of the key it holds.
+   static ULong64_t Distance(const Slot &slot, ULong64_t i, ULong64_t capacity)
+   {
+      const ULong64_t home = Home(Hash(slot.fMajor, slot.fMinor), capacity);
+      return i >= home ? i - home : i + capacity - home;
+   }
+
+   static ULong64_t GetSignature(const char *treeName, const char *major, const char *minor)
+   {
+      // FNV-1a of the three strings, with their terminating zeros
+      ULong64_t hash = 0xcbf29ce484222325ULL;
+      for (const char *s : {treeName, major, minor}) {
+         do {
+            hash = (hash ^ static_cast<unsigned char>(*s)) * 0x100000001b3ULL;
+         } while (*s++);
+      }
+      return hash;
+   }
+
+   static bool IsUpToDate(const std::string &file, ULong64_t signature)
+   {
+      struct stat in, idx;
+      if (stat(file.c_str(), &in) != 0 || stat(GetIndexFileName(file).c_str(), &idx) != 0 ||
+          idx.st_mtime < in.st_mtime)
+         return false;
+      Header header;
+      FILE *f = fopen(GetIndexFileName(file).c_str(), "rb");
+      const bool read = f && fread(&header, sizeof(header), 1, f) == 1;
+      if (f)
+         fclose(f);
+      return read && strncmp(header.fMagic, kMagic, sizeof(header.fMagic)) == 0 && header.fSignature == signature;
+   }
+
+   // Inserts with Robin Hood hashing: a key takes the slot of a key closer to
+   // its home, which then moves on. Keeps the first entry of a duplicated key.
+   static bool Insert(std::vector<Slot> &slots, Slot slot)
+   {
+      const ULong64_t capacity = slots.size();
+      ULong64_t i = Home(Hash(slot.fMajor, slot.fMinor), capacity);
+      bool first = true; // slot is the key inserted, not one it moved
+      for (ULong64_t distance = 0;; ++distance) {
+         Slot &resident = slots[i];
+         if (resident.fEntry == kEmpty) {
+            resident = slot;
+            return true;
+         }
+         if (first && resident.fMajor == slot.fMajor && resident.fMinor == slot.fMinor)
+            return false;
+         const ULong64_t residentDistance = Distance(resident, i, capacity);
+         if (residentDistance < distance) {
+            std::swap(resident, slot);
+            distance = residentDistance;
+            first = false;
+         }
+         if (++i == capacity)
+            i = 0;
+      }
+   }
+
+   static bool BuildFile(const std::string &file, const char *treeName, const char *major, const char *minor,
+                         ULong64_t signature)
+   {
+      std::unique_ptr<TFile> f(TFile::Open(file.c_str()));
+      TTree *tree = nullptr;
+      if (f && !f->IsZombie())
+         f->GetObject(treeName, tree);
+      if (!tree) {
+         Error("HashIndex::Build", "cannot read %s from %s", treeName, file.c_str());
+         return false;
+      }
+      const Long64_t entries = tree->GetEntries();
+      if (entries > kMaxEntries) {
+         Error("HashIndex::Build", "%s has %lld entries, more than %lld", file.c_str(), entries, kMaxEntries);
+         return false;
+      }
+      const ULong64_t capacity = entries + entries / 7 + 1; // 7/8 full
+      Header header;
+      memset(&header, 0, sizeof(header));
+      strncpy(header.fMagic, kMagic, sizeof(header.fMagic));
+      header.fSignature = signature;
+      header.fCapacity = capacity;
+      header.fEntries = entries;
+      header.fMinMajor = ~0ULL;
+      std::vector<Slot> slots(capacity, Slot{0, 0, kEmpty});
+
+      TTreeFormula majorFormula("major", major, tree);
+      TTreeFormula minorFormula("minor", minor, tree);
+      if (majorFormula.GetNdim() == 0 || minorFormula.GetNdim() == 0) {
+         Error("HashIndex::Build", "cannot compile %s or %s for %s", major, minor, file.c_str());
+         return false;
+      }
+      for (Long64_t entry = 0; entry < entries; ++entry) {
+         tree->LoadTree(entry);
+         const Long64_t maj = majorFormula.EvalInstance64();
+         const Long64_t min = minorFormula.EvalInstance64();
+         if (maj < 0 || min < 0 || maj > 0xffffffffLL || min > 0xffffffffLL) {
+            Error("HashIndex::Build", "%s: entry %lld has (%lld, %lld), not in [0, 2^32)", file.c_str(), entry, maj,
+                  min);
+            return false;
+         }
+         if (Insert(slots, Slot{UInt_t(maj), UInt_t(min), UInt_t(entry)})) {
+            ++header.fKeys;
+            header.fMinMajor = std::min<ULong64_t>(header.fMinMajor, maj);
+            header.fMaxMajor = std::max<ULong64_t>(header.fMaxMajor, maj);
+         }
+      }
+
+      // Written under a temporary name, so that readers never see a partial index.
+      const std::string indexFile = GetIndexFileName(file);
+      const std::string tmp = indexFile + ".tmp" + std::to_string(gSystem->GetPid());
+      FILE *out = fopen(tmp.c_str(), "wb");
+      bool ok = out && fwrite(&header, sizeof(header), 1, out) == 1 &&
+                fwrite(slots.data(), sizeof(Slot), capacity, out) == capacity;
+      if (out)
+         ok = fclose(out) == 0 && ok;
+      if (!ok || rename(tmp.c_str(), indexFile.c_str()) != 0) {
+         Error("HashIndex::Build", "cannot write %s", indexFile.c_str());
+         remove(tmp.c_str());
+         return false;
+      }
+      return true;
+   }
+
+   void Unmap()
+   {
+      for (Table &table : fTables)
+         munmap(table.fMap, table.fBytes);
+      fTables.clear();
+      fEntries = 0;
+   }
+
+public:
+   static std::string GetIndexFileName(const std::string &file) { return file + ".hidx"; }
+
+   // Writes the .hidx of the files that have none, an older one or one built
+   // for another tree, major or minor, with nThreads threads.
+   static bool Build(const std::vector<std::string> &files, const char *treeName, const char *major, const char *minor,
+                     unsigned nThreads)
+   {
+      nThreads = std::max(1u, std::min<unsigned>(nThreads, files.size()));
+      if (nThreads > 1)
+         ROOT::EnableThreadSafety();
+      const ULong64_t signature = GetSignature(treeName, major, minor);
+      std::atomic<size_t> next{0};
+      std::atomic<bool> ok{true};
+      auto work = [&] {
+         for (size_t i = next++; i < files.size(); i = next++) {
+            if (!IsUpToDate(files[i], signature) && !BuildFile(files[i], treeName, major, minor, signature))
+               ok = false;
+         }
+      };
+      std::vector<std::thread> threads;
+      for (unsigned t = 1; t < nThreads; ++t)
+         threads.emplace_back(work);
+      work();
+      for (std::thread &t : threads)
+         t.join();
+      return ok;
+   }
+
+   // Maps the .hidx of the files, which must all be built for the same tree,
+   // major and minor.
+   explicit HashIndex(const std::vector<std::string> &files)
+   {
+      for (const std::string &file : files) {
+         const std::string indexFile = GetIndexFileName(file);
+         Table table;
+         int fd = open(indexFile.c_str(), O_RDONLY);
+         struct stat st;
+         if (fd >= 0 && fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(Header)) {
+            table.fBytes = st.st_size;
+            table.fMap = mmap(nullptr, table.fBytes, PROT_READ, MAP_SHARED, fd, 0);
+         }
+         if (fd >= 0)
+            close(fd);
+         if (!table.fMap || table.fMap == MAP_FAILED) {
+            Error("HashIndex", "cannot map %s", indexFile.c_str());
+            Unmap();
+            return;
+         }
+         table.fHeader = static_cast<const Header *>(table.fMap);
+         table.fSlots = reinterpret_cast<const Slot *>(table.fHeader + 1);
+         if (strncmp(table.fHeader->fMagic, kMagic, sizeof(table.fHeader->fMagic)) != 0 ||
+             table.fBytes != sizeof(Header) + table.fHeader->fCapacity * sizeof(Slot)) {
+            Error("HashIndex", "%s is not an index", indexFile.c_str());
+            munmap(table.fMap, table.fBytes);
+            Unmap();
+            return;
+         }
+         if (!fTables.empty() && table.fHeader->fSignature != fTables.front().fHeader->fSignature) {
+            Error("HashIndex", "%s is built for another tree, major or minor than %s", indexFile.c_str(),
+                  GetIndexFileName(files.front()).c_str());
+            munmap(table.fMap, table.fBytes);
+            Unmap();
+            return;
+         }
+         table.fOffset = fEntries;
+         fEntries += table.fHeader->fEntries;
+         fTables.push_back(table);
+      }
+   }
+
+   ~HashIndex() { Unmap(); }
+   HashIndex(const HashIndex &) = delete;
+   HashIndex &operator=(const HashIndex &) = delete;
+
+   bool IsValid() const { return !fTables.empty(); }
+   Long64_t GetEntries() const { return fEntries; }
+
+   // The entry of the chain with the given major and minor, -1 if there is none.
+   Long64_t GetEntryNumberWithIndex(Long64_t major, Long64_t minor) const
+   {
+      if (major < 0 || minor < 0 || major > 0xffffffffLL || minor > 0xffffffffLL)
+         return -1;
+      const UInt_t maj = major, min = minor;
+      const ULong64_t hash = Hash(maj, min);
+      for (const Table &table : fTables) {
+         if (ULong64_t(major) < table.fHeader->fMinMajor || ULong64_t(major) > table.fHeader->fMaxMajor)
+            continue;
+         const ULong64_t capacity = table.fHeader->fCapacity;
+         ULong64_t i = Home(hash, capacity);
+         for (ULong64_t distance = 0;; ++distance) {
+            const Slot &slot = table.fSlots[i];
+            // Robin Hood: the key would be before a key closer to its home.
+            if (slot.fEntry == kEmpty || Distance(slot, i, capacity) < distance)
+               break;
+            if (slot.fMajor == maj && slot.fMinor == min)
+               return table.fOffset + slot.fEntry;
+            if (++i == capacity)
+               i = 0;
+         }
+      }
+      return -1;
+   }
+};
+
+#endif
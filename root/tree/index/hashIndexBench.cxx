@@ -0,0 +1,217 @@
+// TChain::BuildIndex against HashIndex on a synthetic chain.
+//
+//    hashIndexBench [--files=N] [--entries=N] [--lookups=N] [--threads=N] [--skip-chain-index] [--keep]
+//
+// Writes --files files (default 100) of --entries entries (default 1000000,
+// i.e. a chain of 100M entries) with a run (two runs per file) and an event
+// number, shuffled within the run, as in execChainIndex.cxx. Then indexes the
+// chain by (run, event) with
+//
+//    TChainIndex   TChain::BuildIndex("run", "event")
+//    HashIndex     HashIndex::Build with --threads threads (default 4), then
+//                  HashIndex::Build again (nothing to do) and the mapping of
+//                  the .hidx files, as a later job would do
+//
+// and looks up --lookups (run, event) pairs (default 1000000, 1 in 10 not in
+// the chain) in random order. Reports the times, the resident memory added by
+// the index and the lookups per second; fails if the two indices disagree or
+// if HashIndex takes as many bytes per entry as TTreeIndex (24).
+// --skip-chain-index only runs HashIndex, TChainIndex needs 24 bytes per entry.
+
+#include "TChain.h"
+#include "TFile.h"
+#include "TSystem.h"
+#include "TTree.h"
+
+#include "HashIndex.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Query {
+   Int_t fRun;
+   Long64_t fEvent;
+};
+
+double Seconds(std::chrono::steady_clock::time_point start)
+{
+   return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+double ResidentMB()
+{
+   ProcInfo_t info;
+   gSystem->GetProcInfo(&info);
+   return info.fMemResident / 1024.;
+}
+
+bool WriteFile(const std::string &filename, int f, Long64_t entries)
+{
+   TFile file(filename.c_str(), "RECREATE");
+   if (file.IsZombie())
+      return false;
+   TTree t("events", "");
+   Int_t run;
+   Long64_t event;
+   t.Branch("run", &run);
+   t.Branch("event", &event);
+   std::mt19937_64 rng(f);
+   const Long64_t perRun = entries / 2;
+   std::vector<Long64_t> events;
+   for (int r = 0; r < 2; ++r) {
+      run = 1000 + 2 * f + r;
+      events.resize(r == 0 ? perRun : entries - perRun);
+      std::iota(events.begin(), events.end(), 0);
+      std::shuffle(events.begin(), events.end(), rng);
+      for (Long64_t e : events) {
+         event = e;
+         t.Fill();
+      }
+   }
+   file.Write();
+   return true;
+}
+
+std::vector<Query> MakeQueries(int files, Long64_t entries, Long64_t lookups)
+{
+   std::mt19937_64 rng(4357);
+   std::vector<Query> queries(lookups);
+   for (Query &q : queries) {
+      q.fRun = 1000 + rng() % (2 * files);
+      // Runs have entries / 2 events, a tenth of the queries fall beyond.
+      q.fEvent = rng() % (entries / 2 + entries / 20 + 1);
+   }
+   return queries;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+   int nfiles = 100;
+   Long64_t entries = 1000000;
+   Long64_t lookups = 1000000;
+   unsigned threads = 4;
+   bool chainIndex = true;
+   bool keep = false;
+   for (int i = 1; i < argc; ++i) {
+      const char *arg = argv[i];
+      if (strncmp(arg, "--files=", 8) == 0)
+         nfiles = atoi(arg + 8);
+      else if (strncmp(arg, "--entries=", 10) == 0)
+         entries = atoll(arg + 10);
+      else if (strncmp(arg, "--lookups=", 10) == 0)
+         lookups = atoll(arg + 10);
+      else if (strncmp(arg, "--threads=", 10) == 0)
+         threads = atoi(arg + 10);
+      else if (strcmp(arg, "--skip-chain-index") == 0)
+         chainIndex = false;
+      else if (strcmp(arg, "--keep") == 0)
+         keep = true;
+      else {
+         fprintf(stderr,
+                 "Usage: %s [--files=N] [--entries=N] [--lookups=N] [--threads=N] [--skip-chain-index] [--keep]\n",
+                 argv[0]);
+         return 2;
+      }
+   }
+   if (nfiles < 1 || entries < 2) {
+      fprintf(stderr, "Error: need at least one file of two entries\n");
+      return 2;
+   }
+
+   std::vector<std::string> files;
+   for (int f = 0; f < nfiles; ++f) {
+      files.push_back("hashIndex_" + std::to_string(f) + ".root");
+      remove(HashIndex::GetIndexFileName(files.back()).c_str());
+      if (!WriteFile(files.back(), f, entries)) {
+         fprintf(stderr, "Error: cannot write %s\n", files.back().c_str());
+         return 1;
+      }
+   }
+   const std::vector<Query> queries = MakeQueries(nfiles, entries, lookups);
+
+   printf("%-12s %10s %10s %12s %12s\n", "index", "build (s)", "open (s)", "memory (MB)", "lookups/s");
+   std::vector<Long64_t> expected;
+   if (chainIndex) {
+      TChain chain("events");
+      for (const std::string &file : files)
+         chain.Add(file.c_str());
+      chain.GetEntries();
+      const double rss = ResidentMB();
+      auto start = std::chrono::steady_clock::now();
+      chain.BuildIndex("run", "event");
+      const double build = Seconds(start);
+      const double memory = ResidentMB() - rss;
+      expected.reserve(queries.size());
+      start = std::chrono::steady_clock::now();
+      for (const Query &q : queries)
+         expected.push_back(chain.GetEntryNumberWithIndex(q.fRun, q.fEvent));
+      printf("%-12s %10.3f %10s %12.1f %12.0f\n", "TChainIndex", build, "-", memory, queries.size() / Seconds(start));
+   }
+
+   auto start = std::chrono::steady_clock::now();
+   if (!HashIndex::Build(files, "events", "run", "event", threads)) {
+      fprintf(stderr, "Error: cannot build the HashIndex\n");
+      return 1;
+   }
+   const double build = Seconds(start);
+   start = std::chrono::steady_clock::now();
+   HashIndex::Build(files, "events", "run", "event", threads);
+   const double rebuild = Seconds(start);
+
+   const double rss = ResidentMB();
+   start = std::chrono::steady_clock::now();
+   HashIndex index(files);
+   const double open = Seconds(start);
+   if (!index.IsValid() || index.GetEntries() != nfiles * entries) {
+      fprintf(stderr, "Error: cannot open the HashIndex\n");
+      return 1;
+   }
+   int ret = 0;
+   Long64_t found = 0;
+   start = std::chrono::steady_clock::now();
+   for (size_t i = 0; i < queries.size(); ++i) {
+      const Long64_t entry = index.GetEntryNumberWithIndex(queries[i].fRun, queries[i].fEvent);
+      found += entry >= 0;
+      if (!expected.empty() && entry != expected[i] && ret == 0) {
+         fprintf(stderr, "Error: (%d, %lld) is entry %lld for TChainIndex, %lld for HashIndex\n", queries[i].fRun,
+                 queries[i].fEvent, expected[i], entry);
+         ret = 1;
+      }
+   }
+   const double lookupRate = queries.size() / Seconds(start);
+   printf("%-12s %10.3f %10.6f %12.1f %12.0f\n", "HashIndex", build, open, ResidentMB() - rss, lookupRate);
+
+   Long64_t indexBytes = 0;
+   for (const std::string &file : files) {
+      FileStat_t st;
+      if (gSystem->GetPathInfo(HashIndex::GetIndexFileName(file).c_str(), st) == 0)
+         indexBytes += st.fSize;
+   }
+   printf("HashIndex rebuild with all files indexed: %.6f s\n", rebuild);
+   const double bytesPerEntry = double(indexBytes) / index.GetEntries();
+   printf("HashIndex files: %.1f MB, %.1f bytes per entry\n", indexBytes / 1048576., bytesPerEntry);
+   if (bytesPerEntry >= 24.) {
+      fprintf(stderr, "Error: HashIndex takes %.1f bytes per entry, TTreeIndex takes 24\n", bytesPerEntry);
+      ret = 1;
+   }
+   printf("lookups found: %lld of %zu\n", found, queries.size());
+
+   if (!keep) {
+      for (const std::string &file : files) {
+         remove(file.c_str());
+         remove(HashIndex::GetIndexFileName(file).c_str());
+      }
+   }
+   return ret;
+}
@@ -0,0 +1,391 @@
+#ifndef ROOTTEST_PT_BENCH_H
+#define ROOTTEST_PT_BENCH_H
+
+// Minimal microbenchmark harness for roottest executables.
+//
+// Mimics the interface and the JSON output of Google Benchmark, so results
+// can be compared with its tools (e.g. compare.py), without depending on it:
+//
+//    PTBench::Runner runner(argc, argv);
+//    runner.Add("Stream/allint", [](PTBench::State &state) {
+//       // setup
+//       while (state.KeepRunning()) {
+//          // measured code
+//       }
+//       state.SetBytesProcessed(state.iterations() * sizeof(allint));
+//       state.SetItemsProcessed(state.iterations());
+//    });
+//    return runner.Run();
+//
+// Recognized options (all others are left in argv for the caller):
+//    --benchmark_filter=<regex>     only run matching benchmarks
+//    --benchmark_min_time=<s>       minimum measured time per benchmark (0.5)
+//    --benchmark_repetitions=<n>    repeat the measurement, report mean etc
+//    --benchmark_out=<file>         write the results as JSON
+//    --benchmark_list_tests         only print the benchmark names
+//
+// Each benchmark is first run with growing iteration counts until it lasts
+// min_time; this doubles as warm-up. Only the last run is reported. If items
+// were processed, their average real time is reported as ns_per_item.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace PTBench {
+
+class State {
+public:
+   explicit State(long maxIterations): fMaxIterations(maxIterations) {}
+
+   bool KeepRunning() {
+      // Returns true as long as the measured loop shall continue.
+      if (fIterations == 0 && !fStarted) {
+         fStarted = true;
+         ResumeTiming();
+      }
+      if (fIterations < fMaxIterations) {
+         ++fIterations;
+         return true;
+      }
+      PauseTiming();
+      return false;
+   }
+
+   void PauseTiming() {
+      // Stop the clocks, e.g. to exclude per-iteration setup.
+      if (!fRunning)
+         return;
+      fRealTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - fRealStart).count();
+      fCpuTime += double(std::clock() - fCpuStart) / CLOCKS_PER_SEC;
+      fRunning = false;
+   }
+
+   void ResumeTiming() {
+      if (fRunning)
+         return;
+      fRealStart = std::chrono::steady_clock::now();
+      fCpuStart = std::clock();
+      fRunning = true;
+   }
+
+   long iterations() const { return fIterations; }
+   void SetBytesProcessed(double bytes) { fBytes = bytes; }
+   void SetItemsProcessed(double items) { fItems = items; }
+   void SetLabel(const std::string &label) { fLabel = label; }
+   void SkipWithError(const std::string &msg) { fError = msg; }
+
+   std::map<std::string, double> counters; // reported as is, per run
+
+private:
+   friend class Runner;
+
+   long fMaxIterations;
+   long fIterations = 0;
+   bool fStarted = false;
+   bool fRunning = false;
+   std::chrono::steady_clock::time_point fRealStart;
+   std::clock_t fCpuStart = 0;
+   double fRealTime = 0.; // seconds
+   double fCpuTime = 0.; // seconds
+   double fBytes = 0.;
+   double fItems = 0.;
+   std::string fLabel;
+   std::string fError;
+};
+
+class Runner {
+public:
+   using Function_t = std::function<void(State &)>;
+
+   Runner(int &argc, char **argv) {
+      // Consume our options from argv.
+      fExecutable = argc ? argv[0] : "";
+      int out = 1;
+      for (int i = 1; i < argc; ++i) {
+         std::string arg(argv[i]);
+         if (!ParseOption(arg))
+            argv[out++] = argv[i];
+      }
+      argc = out;
+   }
+
+   void Add(const std::string &name, Function_t func) { fBenchmarks.push_back({name, func}); }
+
+   // Defaults for options not given on the command line.
+   void SetMinTime(double seconds) {
+      if (!fMinTimeGiven)
+         fMinTime = seconds;
+   }
+   void SetRepetitions(int n) {
+      if (!fRepetitionsGiven)
+         fRepetitions = std::max(1, n);
+   }
+
+   int Run() {
+      // Run all selected benchmarks, print and store the results.
+      // Returns 1 if a benchmark reported an error, 0 otherwise.
+      std::regex filter(fFilter);
+      int ret = 0;
+      if (!fListOnly)
+         printf("%-50s %15s %15s %12s %14s %14s\n", "Benchmark", "Time (ns)", "CPU (ns)", "Iterations", "Bytes/s", "Items/s");
+      for (auto &bm : fBenchmarks) {
+         if (!std::regex_search(bm.first, filter))
+            continue;
+         if (fListOnly) {
+            printf("%s\n", bm.first.c_str());
+            continue;
+         }
+         std::vector<Result> reps;
+         for (int r = 0; r < fRepetitions; ++r) {
+            Result res = RunOne(bm.first, bm.second);
+            res.fRepetitionIndex = r;
+            Print(res);
+            reps.push_back(res);
+            if (!res.fError.empty()) {
+               ret = 1;
+               break;
+            }
+         }
+         fResults.insert(fResults.end(), reps.begin(), reps.end());
+         if (fRepetitions > 1 && reps.size() == (size_t)fRepetitions)
+            AddAggregates(reps);
+      }
+      if (!fOutFile.empty() && !fListOnly)
+         WriteJSON();
+      return ret;
+   }
+
+private:
+   struct Result {
+      std::string fName;
+      std::string fRunName;
+      std::string fAggregate; // empty for iteration runs
+      int fRepetitionIndex = 0;
+      long fIterations = 0;
+      double fRealTime = 0.; // ns per iteration
+      double fCpuTime = 0.; // ns per iteration
+      double fBytesPerSecond = 0.;
+      double fItemsPerSecond = 0.;
+      std::string fLabel;
+      std::string fError;
+      std::map<std::string, double> fCounters;
+   };
+
+   bool ParseOption(const std::string &arg) {
+      auto value = [&arg](const char *opt, std::string &val) {
+         std::string prefix = std::string("--") + opt + "=";
+         if (arg.compare(0, prefix.size(), prefix) != 0)
+            return false;
+         val = arg.substr(prefix.size());
+         return true;
+      };
+      std::string val;
+      if (value("benchmark_filter", val))
+         fFilter = val;
+      else if (value("benchmark_min_time", val)) {
+         fMinTime = atof(val.c_str()); // also accepts "0.5s"
+         fMinTimeGiven = true;
+      } else if (value("benchmark_repetitions", val)) {
+         fRepetitions = std::max(1, atoi(val.c_str()));
+         fRepetitionsGiven = true;
+      }
+      else if (value("benchmark_out", val))
+         fOutFile = val;
+      else if (value("benchmark_out_format", val))
+         ; // only json is supported
+      else if (arg == "--benchmark_list_tests" || arg == "--benchmark_list_tests=true")
+         fListOnly = true;
+      else
+         return false;
+      return true;
+   }
+
+   Result RunOne(const std::string &name, Function_t &func) {
+      long iterations = 1;
+      while (true) {
+         State state(iterations);
+         func(state);
+         state.PauseTiming();
+         double elapsed = std::max(state.fRealTime, state.fCpuTime);
+         bool done = !state.fError.empty() || elapsed >= fMinTime || iterations >= kMaxIterations;
+         if (done) {
+            Result res;
+            res.fName = name;
+            res.fRunName = name;
+            res.fIterations = state.fIterations;
+            double n = std::max(1L, state.fIterations);
+            res.fRealTime = state.fRealTime / n * 1e9;
+            res.fCpuTime = state.fCpuTime / n * 1e9;
+            if (state.fRealTime > 0.) {
+               res.fBytesPerSecond = state.fBytes / state.fRealTime;
+               res.fItemsPerSecond = state.fItems / state.fRealTime;
+            }
+            res.fLabel = state.fLabel;
+            res.fError = state.fError;
+            res.fCounters = state.counters;
+            if (state.fItems > 0.)
+               res.fCounters["ns_per_item"] = state.fRealTime / state.fItems * 1e9;
+            return res;
+         }
+         // Aim for 1.4 * min_time, growing by at most 10x per step.
+         double multiplier = elapsed > 0. ? fMinTime * 1.4 / elapsed : 10.;
+         multiplier = std::min(10., std::max(multiplier, 2.));
+         iterations = std::min(kMaxIterations, (long)(iterations * multiplier));
+      }
+   }
+
+   void AddAggregates(const std::vector<Result> &reps) {
+      auto aggregate = [&](const char *what, std::function<double(std::vector<double>)> fn) {
+         Result agg = reps.front();
+         agg.fName = agg.fRunName + "_" + what;
+         agg.fAggregate = what;
+         auto apply = [&](double Result::*member) {
+            std::vector<double> vals;
+            for (auto &r : reps)
+               vals.push_back(r.*member);
+            agg.*member = fn(vals);
+         };
+         apply(&Result::fRealTime);
+         apply(&Result::fCpuTime);
+         apply(&Result::fBytesPerSecond);
+         apply(&Result::fItemsPerSecond);
+         for (auto &c : agg.fCounters) {
+            std::vector<double> vals;
+            for (auto &r : reps)
+               vals.push_back(r.fCounters.at(c.first));
+            c.second = fn(vals);
+         }
+         Print(agg);
+         fResults.push_back(agg);
+      };
+      auto mean = [](std::vector<double> v) {
+         double sum = 0.;
+         for (double x : v)
+            sum += x;
+         return sum / v.size();
+      };
+      aggregate("mean", mean);
+      aggregate("median", [](std::vector<double> v) {
+         std::sort(v.begin(), v.end());
+         return v.size() % 2 ? v[v.size() / 2] : (v[v.size() / 2 - 1] + v[v.size() / 2]) / 2.;
+      });
+      aggregate("stddev", [mean](std::vector<double> v) {
+         double m = mean(v);
+         double sum2 = 0.;
+         for (double x : v)
+            sum2 += (x - m) * (x - m);
+         return v.size() > 1 ? std::sqrt(sum2 / (v.size() - 1)) : 0.;
+      });
+   }
+
+   void Print(const Result &res) const {
+      if (!res.fError.empty()) {
+         printf("%-50s ERROR: %s\n", res.fName.c_str(), res.fError.c_str());
+         return;
+      }
+      printf("%-50s %15.1f %15.1f %12ld %14.4g %14.4g", res.fName.c_str(), res.fRealTime, res.fCpuTime,
+             res.fIterations, res.fBytesPerSecond, res.fItemsPerSecond);
+      for (auto &c : res.fCounters)
+         printf(" %s=%g", c.first.c_str(), c.second);
+      if (!res.fLabel.empty())
+         printf(" %s", res.fLabel.c_str());
+      printf("\n");
+   }
+
+   static std::string Escape(const std::string &str) {
+      std::string out;
+      for (char c : str) {
+         if (c == '"' || c == '\\')
+            out += '\\';
+         out += c;
+      }
+      return out;
+   }
+
+   void WriteJSON() const {
+      FILE *out = fopen(fOutFile.c_str(), "w");
+      if (!out) {
+         fprintf(stderr, "Error PTBench: cannot open %s\n", fOutFile.c_str());
+         return;
+      }
+      char host[256] = "";
+      gethostname(host, sizeof(host) - 1);
+      char date[64] = "";
+      std::time_t now = std::time(nullptr);
+      std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+      fprintf(out, "{\n  \"context\": {\n");
+      fprintf(out, "    \"date\": \"%s\",\n", date);
+      fprintf(out, "    \"host_name\": \"%s\",\n", Escape(host).c_str());
+      fprintf(out, "    \"executable\": \"%s\",\n", Escape(fExecutable).c_str());
+      fprintf(out, "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+#ifdef NDEBUG
+      fprintf(out, "    \"library_build_type\": \"release\"\n");
+#else
+      fprintf(out, "    \"library_build_type\": \"debug\"\n");
+#endif
+      fprintf(out, "  },\n  \"benchmarks\": [");
+      for (size_t i = 0; i < fResults.size(); ++i) {
+         const Result &res = fResults[i];
+         fprintf(out, "%s\n    {\n", i ? "," : "");
+         fprintf(out, "      \"name\": \"%s\",\n", Escape(res.fName).c_str());
+         fprintf(out, "      \"run_name\": \"%s\",\n", Escape(res.fRunName).c_str());
+         if (res.fAggregate.empty()) {
+            fprintf(out, "      \"run_type\": \"iteration\",\n");
+            fprintf(out, "      \"repetition_index\": %d,\n", res.fRepetitionIndex);
+         } else {
+            fprintf(out, "      \"run_type\": \"aggregate\",\n");
+            fprintf(out, "      \"aggregate_name\": \"%s\",\n", res.fAggregate.c_str());
+         }
+         fprintf(out, "      \"repetitions\": %d,\n", fRepetitions);
+         fprintf(out, "      \"threads\": 1,\n");
+         if (!res.fError.empty()) {
+            fprintf(out, "      \"error_occurred\": true,\n");
+            fprintf(out, "      \"error_message\": \"%s\",\n", Escape(res.fError).c_str());
+         }
+         if (!res.fLabel.empty())
+            fprintf(out, "      \"label\": \"%s\",\n", Escape(res.fLabel).c_str());
+         for (auto &c : res.fCounters)
+            fprintf(out, "      \"%s\": %.17g,\n", Escape(c.first).c_str(), c.second);
+         if (res.fBytesPerSecond > 0.)
+            fprintf(out, "      \"bytes_per_second\": %.17g,\n", res.fBytesPerSecond);
+         if (res.fItemsPerSecond > 0.)
+            fprintf(out, "      \"items_per_second\": %.17g,\n", res.fItemsPerSecond);
+         fprintf(out, "      \"iterations\": %ld,\n", res.fIterations);
+         fprintf(out, "      \"real_time\": %.17g,\n", res.fRealTime);
+         fprintf(out, "      \"cpu_time\": %.17g,\n", res.fCpuTime);
+         fprintf(out, "      \"time_unit\": \"ns\"\n    }");
+      }
+      fprintf(out, "\n  ]\n}\n");
+      fclose(out);
+   }
+
+   static constexpr long kMaxIterations = 1000000000L;
+
+   std::vector<std::pair<std::string, Function_t>> fBenchmarks;
+   std::vector<Result> fResults;
+   std::string fExecutable;
+   std::string fFilter = ".";
+   std::string fOutFile;
+   double fMinTime = 0.5;
+   int fRepetitions = 1;
+   bool fMinTimeGiven = false;
+   bool fRepetitionsGiven = false;
+   bool fListOnly = false;
+};
+
+} // namespace PTBench
+
+#endif
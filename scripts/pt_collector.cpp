@@ -38,6 +38,7 @@ enum EMeasurement {
    kMemPeak,
    kMemAlloc,
    kCPUTime,
+   kWallTime,
    kNumMeasurements
 };
 
@@ -84,58 +85,89 @@ public:
    PTGraph* gr[kNumMeasurements];
 };
 
-const double zLimits[] = {
+double zLimits[] = {
    3.5 /*memleak*/,
    4.5 /*mempeak*/,
    5.0 /*memalloc*/,
-   5.0 /*cputime*/
+   5.0 /*cputime*/,
+   5.0 /*walltime*/
 };
 
 const double uncertainty[] = {
    0.50 /*memleak*/,
    1.00 /*mempeak*/,
    1.00 /*memalloc*/,
-   0.05 /*cputime*/
+   0.05 /*cputime*/,
+   0.10 /*walltime*/
 };
 
 const char* measurementNames[kNumMeasurements] = {
    "memory leaks (kB)",
    "peak memory usage (kB)",
    "sum of memory allocations (kB)",
-   "cpu time (s)"
+   "cpu time (s)",
+   "wall time (s)"
+};
+
+// Measurements that make pt_collector fail when they are outliers, see
+// option -z. Without -z, outliers are only reported.
+const int gateMeasurements = (1 << kMemPeak) | (1 << kWallTime);
+
+struct PTOptions {
+   PTOptions(): zLimit(-1.) {}
+
+   TString testName; // -n: name of the test; default: derived from the command
+   TString dataDir; // -d: directory holding the history files; default: cwd
+   TString preload; // -p: interposition library; default: scripts/ptpreload.so
+   double zLimit; // -z: fail the test beyond zLimit sigmas of peak memory and wall time
 };
 
 //______________________________________________________________________________
-void InvokeChild(char** argv, const TString& roottestHome){
+void InvokeChild(char** argv, const TString& roottestHome, const PTOptions& opts){
    // We are the fork's child. Convert ourselves into root.exe (or whatever else was argv[2])
 
-   setenv("LD_PRELOAD", roottestHome + "/scripts/ptpreload.so", 1);
+   if (opts.preload.Length())
+      setenv("LD_PRELOAD", opts.preload, 1);
+   else
+      setenv("LD_PRELOAD", roottestHome + "/scripts/ptpreload.so", 1);
    execvp(argv[0], argv);
+   printf("Error pt_collector: cannot execute %s: %s\n", argv[0], strerror(errno));
+   _exit(127);
 }
 
 //______________________________________________________________________________
-PTMeasurement ReceiveResults(const TString& fifoName) {
+PTMeasurement ReceiveResults(const TString& fifoName, pid_t pid) {
    // Retrieve the measurements from the FIFO and from the child's usage data.
 
-   int fd = open(fifoName, O_RDONLY);
+   // Don't block until the child opens the FIFO: it never does if it cannot
+   // be executed.
+   int fd = open(fifoName, O_RDONLY | O_NONBLOCK);
    if (fd < 0) {
       printf("Error pt_collector: opening FIFO %s, %s\n", fifoName.Data(), strerror(errno));
+      unlink(fifoName);
       exit(1);
    }
 
    // read child performance information
    int status;
-   wait(&status);
+   waitpid(pid, &status, 0);
    if (status != 0){
+      close(fd);
       unlink(fifoName);
-      exit(status); // test failed
+      // test failed; forward its exit code or signal
+      if (WIFEXITED(status))
+         exit(WEXITSTATUS(status));
+      exit(128 + WTERMSIG(status));
    }
 
-   // get memory
+   // get memory; block again in case a process started by the child still
+   // holds the FIFO open
    PTMeasurement results;
-   read(fd, &results, 4*sizeof(long));
+   fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+   ssize_t nread = read(fd, &results, 4*sizeof(long));
+   close(fd);
    unlink(fifoName);
-   if (results.memory[3] != 699692586){
+   if (nread != (ssize_t)(4*sizeof(long)) || results.memory[3] != 699692586){
       printf("Error pt_collector: could not read memory usage from FIFO %s\n", fifoName.Data());;
       exit(1);
    }
@@ -149,14 +181,18 @@ PTMeasurement ReceiveResults(const TString& fifoName) {
 }
 
 //______________________________________________________________________________
-TTree* GetTree(TString& fileName, TString& testName, int argc, char** argv, const TString& cwd, const TString& roottestHome) {
+TTree* GetTree(TString& fileName, TString& testName, int argc, char** argv, const TString& cwd, const TString& roottestHome, const PTOptions& opts) {
    TString lastArg(argv[argc-1]);
 
    // build test name
-   testName = cwd + "/" + lastArg;
-   if (testName.BeginsWith(roottestHome)) {
-      testName.Remove(0, roottestHome.Length());
-      if (testName[0] == '/') testName.Remove(0, 1);
+   if (opts.testName.Length()) {
+      testName = opts.testName;
+   } else {
+      testName = cwd + "/" + lastArg;
+      if (testName.BeginsWith(roottestHome)) {
+         testName.Remove(0, roottestHome.Length());
+         if (testName[0] == '/') testName.Remove(0, 1);
+      }
    }
 
    // build file name
@@ -169,6 +205,10 @@ TTree* GetTree(TString& fileName, TString& testName, int argc, char** argv, cons
    fileName.Prepend("pt_");
    fileName += testName.MD5();
    fileName += ".root";
+   if (opts.dataDir.Length()) {
+      gSystem->mkdir(opts.dataDir, true);
+      fileName.Prepend(opts.dataDir + "/");
+   }
 
    TFile* file = TFile::Open(fileName, "UPDATE");
    if (!file || file->IsZombie()) {
@@ -207,11 +247,12 @@ void FillData(const PTMeasurement& results, TTree* tree, PTData& prevdata, PTDat
    time(&rawtime);
    newdata.date = ctime(&rawtime);
 
-   double resdata[4] = {
+   double resdata[kNumMeasurements] = {
       results.memory[kMemLeak]/1024.,
       results.memory[kMemPeak]/1024.,
       results.memory[kMemAlloc]/1024., // in kilobyte
-      results.utime + results.stime // in seconds
+      results.utime + results.stime, // in seconds
+      results.wtime // in seconds
    };
 
    newdata.statEntries = prevdata.statEntries + 1;
@@ -219,7 +260,8 @@ void FillData(const PTMeasurement& results, TTree* tree, PTData& prevdata, PTDat
    for (int i = 0; i < kNumMeasurements; ++i) {
       newdata.pval[i]->Set(resdata[i], *prevdata.pval[i], newdata.statEntries);
    }
-   newdata.svn = gROOT->GetSvnRevision();
+   // ROOT has no svn revision anymore; order the measurements by time instead.
+   newdata.svn = (unsigned int)rawtime;
    newdata.outlier = 0;
 }
 
@@ -330,12 +372,12 @@ void RevertOutlierStat(TTree* tree, const PTData& prevdata, PTData& newdata) {
 
 //______________________________________________________________________________
 void ReportFailures(const PTData& newdata, const TString& testName,
-                    const TString& fileName) {
+                    const TString& fileName, int mask, ostream& out) {
 
    for (int i = 0; i < kNumMeasurements; ++i) {
-      if (newdata.outlier & (1 << i)) {
-         cout << "Performance decrease (" << measurementNames[i] << ") for test " << testName << " in file " << fileName << endl;
-         cout << "   Measured: " << newdata.pval[i]->fVal << endl
+      if (newdata.outlier & mask & (1 << i)) {
+         out << "Performance decrease (" << measurementNames[i] << ") for test " << testName << " in file " << fileName << endl;
+         out << "   Measured: " << newdata.pval[i]->fVal << endl
               << "   Mean: " << newdata.pval[i]->fMean << endl
               << "   Variance: " << newdata.pval[i]->fVar << endl
               << "   Delta: " << newdata.pval[i]->fZ << "sigmas" << endl;
@@ -450,7 +492,8 @@ void SaveGraphs(PTGraphColl* graphs, const TString& dataFileName, const TString&
       gPad->Update();
       gPad->SetGrid();
 
-      mg->GetXaxis()->SetTitle("SVN revision");
+      mg->GetXaxis()->SetTitle("time of measurement");
+      mg->GetXaxis()->SetTimeDisplay(1);
       mg->GetXaxis()->SetTitleOffset(1.0);
       //mg->GetYaxis()->SetTitle(measurementNames[i]);
       //mg->GetYaxis()->SetTitleOffset(1.5);
@@ -476,14 +519,40 @@ int main(int argc, char** argv)
 {
    TH1::AddDirectory(false);
 
+   ++argv; // skip program name "pt_collector", previous argv[1] becomes argv[0] etc
+   --argc;
+
+   PTOptions opts;
+   while (argc > 1 && argv[0][0] == '-' && argv[0][1] && !argv[0][2]) {
+      switch (argv[0][1]) {
+      case 'n': opts.testName = argv[1]; break;
+      case 'd': opts.dataDir = argv[1]; break;
+      case 'p': opts.preload = argv[1]; break;
+      case 'z': opts.zLimit = atof(argv[1]); break;
+      default:
+         printf("Error pt_collector: unknown option %s\n", argv[0]);
+         return 1;
+      }
+      argv += 2;
+      argc -= 2;
+   }
+
    if (argc < 2) {
       printf("Error: insufficient number of arguments.\n"
-             "  pt_collector <ROOTTEST_HOME> program arguments...\n");
+             "  pt_collector [-n testname] [-d datadir] [-p preloadlib] [-z zlimit]\n"
+             "               <ROOTTEST_HOME> program arguments...\n");
       return 1;
    }
 
-   ++argv; // skip program name "pt_collector", previous argv[1] becomes argv[0] etc
-   --argc;
+   // With -z, peak memory and wall time become a pass / fail criterion.
+   int failMask = 0;
+   if (opts.zLimit > 0.) {
+      failMask = gateMeasurements;
+      for (int i = 0; i < kNumMeasurements; ++i) {
+         if (failMask & (1 << i))
+            zLimits[i] = opts.zLimit;
+      }
+   }
 
    TString roottestHome(argv[0]);
    ++argv;
@@ -498,13 +567,20 @@ int main(int argc, char** argv)
    setenv("PT_FIFONAME", fifoName, 1);
    mkfifo(fifoName, 0666);
 
+   struct timeval wstart;
+   gettimeofday(&wstart, 0);
+
    pid_t pid=fork();
-   if (pid == 0) InvokeChild(argv, roottestHome);
+   if (pid == 0) InvokeChild(argv, roottestHome, opts);
    else {
-      PTMeasurement results = ReceiveResults(fifoName);
+      PTMeasurement results = ReceiveResults(fifoName, pid);
+      struct timeval wstop;
+      gettimeofday(&wstop, 0);
+      results.wtime = (wstop.tv_sec - wstart.tv_sec) + (wstop.tv_usec - wstart.tv_usec)/1000000.;
+
       TString test;
       TString file;
-      TTree* tree = GetTree(file, test, argc, argv, cwd, roottestHome);
+      TTree* tree = GetTree(file, test, argc, argv, cwd, roottestHome, opts);
       PTData olddata;
       PTGraphColl* graphs = CreateOldGraphs(tree,olddata);
       PTData newdata;
@@ -515,13 +591,18 @@ int main(int argc, char** argv)
       SaveGraphs(graphs, file, test);
       delete graphs;
 
+      bool failed = newdata.outlier & failMask;
       if (newdata.outlier) {
-         ReportFailures(newdata, test, file);
+         if (failMask)
+            ReportFailures(newdata, test, file, failMask, cerr);
+         else
+            ReportFailures(newdata, test, file, ~0, cout);
          RevertOutlierStat(tree, olddata, newdata);
       }
 
       DeleteOldEntries(tree, newdata.historyThinningCounter, file);
       UpdateTree(tree, newdata);
+      return failed ? 1 : 0;
    }
+   return 0;
 }
-
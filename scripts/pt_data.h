@@ -1,6 +1,8 @@
 #include "TObject.h"
 #include "TString.h"
 
+#include <cmath>
+
 class PTVal: public TObject {
 public:
    PTVal(): fVal(), fZ(), fMean(), fVar(), fSumVal2() {}
@@ -39,7 +41,8 @@ public:
       memleak(o.memleak),
       mempeak(o.mempeak),
       memalloc(o.memalloc),
-      cputime(o.cputime)
+      cputime(o.cputime),
+      walltime(o.walltime)
    { PSet(); }
 
    PTData& operator=(const PTData& o) {
@@ -52,6 +55,7 @@ public:
       memleak = o.memleak;
       mempeak = o.mempeak;
       cputime = o.cputime;
+      walltime = o.walltime;
       PSet();
       return *this;
    }
@@ -61,10 +65,11 @@ public:
       pval[1] = &mempeak;
       pval[2] = &memalloc;
       pval[3] = &cputime;
+      pval[4] = &walltime;
    }
 
-   int outlier; // memalloc == 1 | memleak == 2 | mempeak == 4 | cputime == 8
-   unsigned int svn; // ROOT svn revision
+   int outlier; // memleak == 1 | mempeak == 2 | memalloc == 4 | cputime == 8 | walltime == 16
+   unsigned int svn; // time of the measurement (was: ROOT svn revision)
    unsigned int statEntries; // number of measurements in averages etc, incl current
    unsigned int historyThinningCounter; // counter for deletion of old entries
    TString date;
@@ -72,9 +77,10 @@ public:
    PTVal mempeak;
    PTVal memalloc;
    PTVal cputime;
+   PTVal walltime;
 
-   PTVal* pval[4]; //!
+   PTVal* pval[5]; //!
 
-   ClassDef(PTData,1)
+   ClassDef(PTData,2)
 }; 
     
@@ -1,45 +1,94 @@
 #include <sys/types.h>
 #include <errno.h>
 #include <dlfcn.h>
+#include <execinfo.h>
 #include <fcntl.h>
 #if defined(__APPLE__)
+#include <malloc/malloc.h>
 #include <stdlib.h>
+#define PT_USABLE_SIZE(ptr) malloc_size(ptr)
 #else
 #include <malloc.h>
+#define PT_USABLE_SIZE(ptr) malloc_usable_size(ptr)
 #endif
-#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
-// Intercepts calls to malloc, realloc, free, by planting replacement symbols.
-// This library is meant to be LD_PRELOAD'ed to do its job.
+#include <atomic>
+#include <new>
+
+// Intercepts calls to malloc, calloc, realloc, free, aligned_alloc,
+// posix_memalign, memalign, valloc and operator new / delete, by planting
+// replacement symbols. This library is meant to be LD_PRELOAD'ed to do its job.
 //
 // Collects statistics and pipes them back through a FIFO specified in the
 // env var PT_FIFONAME.
 //
-// Manipulates allocations by prepending a TAG value of size int and the size of
-// the allocation (size_t).
+// Allocations are not modified: their size is taken from the allocator's
+// usable size, both when allocating and when freeing, so the heap statistics
+// are consistent and the memory layout seen by the test is unchanged.
+//
+// Counters are kept per thread and only summed at exit; the current and peak
+// heap sizes are global atomics. No lock is taken on any allocation path, so
+// multithreaded (IMT) tests are not serialized by the measurement.
 //
-// The initialization of the counting structures and forwarding function pointers
-// happens upon the first call to malloc / realloc / free; this assumes that no
-// threads have been created before the first call to malloc / realloc / free.
+// The forwarding function pointers are resolved by the first thread calling
+// into any of the replacement functions; allocations requested while this
+// happens (e.g. by dlsym itself, or by concurrent threads) are served from a
+// static bootstrap arena. Threads may thus exist before the first allocation.
+//
+// If the env var PT_SAMPLE is set to N > 0, the call stack of every Nth
+// allocation of each thread is hashed and the allocated bytes are attributed
+// to it. At exit, the hottest call sites are written to the file named by
+// PT_SITES, or to stderr.
 //
 
 class PerfTrackMallocInterposition {
 public:
    static PerfTrackMallocInterposition& Instance() {
-      static PerfTrackMallocInterposition pt;
-      return pt;
+      return fgInstance;
    }
 
    void* Malloc(size_t size);
+   void* Calloc(size_t num, size_t size);
    void* Realloc(void* ptr, size_t size);
+   void* Memalign(size_t alignment, size_t size);
+   int   PosixMemalign(void** memptr, size_t alignment, size_t size);
    void  Free(void* ptr);
 
+   constexpr PerfTrackMallocInterposition():
+      fState(kUninitialized), fPMalloc(), fPCalloc(), fPRealloc(), fPMemalign(),
+      fPPosixMemalign(), fPFree(), fFifoFD(-1), fSampleEvery(0), fSelfBase(), fCurrentHeap(0),
+      fMaxHeap(0), fNumThreads(0), fNumDroppedSites(0), fBootstrapUsed(0), fBootstrap() {}
+
+   ~PerfTrackMallocInterposition() {
+      // Tear down: sum up the per-thread counters and report.
+      if (fState.load() != kReady)
+         return;
+
+      long perfData[kNumPerfDataTypes] = {};
+      perfData[kPDCurrentHeap] = fCurrentHeap.load();
+      perfData[kPDMaxHeap] = fMaxHeap.load();
+      int nthreads = fNumThreads.load();
+      if (nthreads > kMaxThreads)
+         nthreads = kMaxThreads;
+      for (int i = 0; i < nthreads; ++i)
+         perfData[kPDSumAllocs] += fThreadData[i].fSumAllocs.load(std::memory_order_relaxed);
+      perfData[kPDSumAllocs] += fOverflowThreadData.fSumAllocs.load(std::memory_order_relaxed);
+      perfData[kPDTag] = 699692586; // for collector to know that stored values are valid
+
+      if (fFifoFD >= 0 && write(fFifoFD, &perfData, sizeof(perfData))==-1)
+         printf("%s:%d: Error writing statistics to fifo: %s\n", __FILE__, __LINE__, strerror(errno));
+
+      if (fSampleEvery > 0)
+         WriteSites();
+   }
+
 private:
-   // Statistics elements
+   // Statistics elements, in the order expected by pt_collector
    enum EPerfDataType {
       kPDCurrentHeap,
       kPDMaxHeap,
@@ -48,150 +97,366 @@ private:
       kNumPerfDataTypes
    };
 
-   PerfTrackMallocInterposition(): fFifoFD(-1), fPerfData() {
-      // Initialize data structures, mutex, fifo.
-      SetFunc((void**)&fPMalloc, "malloc");
-      SetFunc((void**)&fPRealloc, "realloc");
-      SetFunc((void**)&fPFree, "free");
+   enum EState {
+      kUninitialized,
+      kInitializing,
+      kReady
+   };
 
-      pthread_mutex_init(&fgPTMutex, 0);
+   enum {
+      kMaxThreads = 1024, // threads beyond share fOverflowThreadData
+      kNumSites = 4096, // size of the call site hash table, power of 2
+      kSiteDepth = 16, // stack frames kept per call site
+      kSiteSkip = 4, // at most this many of our own frames top each stack
+      kNumReportedSites = 20,
+      kBootstrapSize = 64 * 1024,
+      kBootstrapHeader = 16 // size prefix of bootstrap blocks, keeps them 16-byte aligned
+   };
 
-      static char envPreload[] = "LD_PRELOAD=";
-      putenv(envPreload);
+   struct alignas(64) ThreadData { // one cache line per thread, no false sharing
+      constexpr ThreadData(): fSumAllocs(0), fNumAllocs(0) {}
+      std::atomic<long> fSumAllocs; // uncontended unless in fOverflowThreadData
+      std::atomic<long> fNumAllocs; // used for sampling
+   };
 
-      // Open the FIFO:
-      static const char* fifoenv = "PT_FIFONAME";
-      const char* fifoname = getenv(fifoenv);
-      if (fifoname) {
-         fFifoFD = open(fifoname, O_WRONLY);
-         if (fFifoFD < 0) {
-            printf("%s:%d: Error opening FIFO %s: %s\n", __FILE__, __LINE__, fifoname, strerror(errno)); 
-         }
-      } else {
-         printf("%s:%d: %s not set: %s\n", __FILE__, __LINE__, fifoenv, strerror(errno)); 
-      }
-      fPerfData[kPDTag]=699692586; // for collector to know that stored values are valid
-   }
+   struct CallSite {
+      constexpr CallSite(): fHash(0), fCount(0), fBytes(0), fNumFrames(0), fFrames() {}
+      std::atomic<uint64_t> fHash; // 0: unused
+      std::atomic<long> fCount;
+      std::atomic<long> fBytes;
+      std::atomic<int> fNumFrames; // set once fFrames is filled
+      void* fFrames[kSiteDepth];
+   };
 
-   ~PerfTrackMallocInterposition() {
-      // Tear down.
-      pthread_mutex_destroy(&fgPTMutex);
+   bool Init();
+   void SetFunc(void** ppFunc, const char* name) const;
+   ThreadData& GetThreadData();
+   void* BootstrapAlloc(size_t size);
+   bool IsBootstrap(const void* ptr) const {
+      return (const char*)ptr >= fBootstrap && (const char*)ptr < fBootstrap + kBootstrapSize;
+   }
+   void SampleCallSite(size_t size);
+   void WriteSites();
 
-      if (fFifoFD >= 0 && write(fFifoFD, &fPerfData, sizeof(fPerfData))==-1)
-         printf("%s:%d: Error writing statistics to fifo: %s\n", __FILE__, __LINE__, strerror(errno)); 
+   bool Ready() {
+      // Whether the forwarding functions can be used; initializes them if needed.
+      return fState.load(std::memory_order_acquire) == kReady || Init();
    }
 
-   void SetFunc(void** ppFunc, const char* name) const {
-      // Find the next (i.e. not ours :-) symbol called name.
-      *ppFunc = dlsym(RTLD_NEXT, name);
-      const char* error = dlerror();
-      if (error != NULL) {
-         printf("%s:%d: Error looking for original symbol %s: %s\n", __FILE__, __LINE__, name, error);
-         exit(1);
+   void IncHeap(void* ptr) {
+      // Increase our heap statistics counter by the size of the new allocation ptr.
+      if (!ptr)
+         return;
+      long size = PT_USABLE_SIZE(ptr);
+      ThreadData& td = GetThreadData();
+      td.fSumAllocs.fetch_add(size, std::memory_order_relaxed);
+      long heap = fCurrentHeap.fetch_add(size, std::memory_order_relaxed) + size;
+      long peak = fMaxHeap.load(std::memory_order_relaxed);
+      while (heap > peak && !fMaxHeap.compare_exchange_weak(peak, heap, std::memory_order_relaxed))
+         ;
+      if (fSampleEvery > 0) {
+         long n = td.fNumAllocs.fetch_add(1, std::memory_order_relaxed) + 1;
+         if (n % fSampleEvery == 0)
+            SampleCallSite(size);
       }
    }
 
-   void IncHeap(size_t size) {
-      // Increase our heap statistics counter.
-      fPerfData[kPDCurrentHeap] += size; // heap
-      fPerfData[kPDSumAllocs] += size; // only allocs
-      if (fPerfData[kPDCurrentHeap] > fPerfData[kPDMaxHeap])
-         fPerfData[kPDMaxHeap] = fPerfData[kPDCurrentHeap];
+   void DecHeap(void* ptr) {
+      // Decrease our heap statistics counter by the size of ptr, about to be freed.
+      fCurrentHeap.fetch_sub(PT_USABLE_SIZE(ptr), std::memory_order_relaxed);
    }
 
+   std::atomic<int> fState;
+
    void* (*fPMalloc)(size_t);
+   void* (*fPCalloc)(size_t, size_t);
    void* (*fPRealloc)(void*, size_t);
+   void* (*fPMemalign)(size_t, size_t);
+   int   (*fPPosixMemalign)(void**, size_t, size_t);
    void  (*fPFree)(void*);
 
    int fFifoFD; // file decriptor of FIFO
-   long fPerfData[kNumPerfDataTypes]; // statistics data
-   static pthread_mutex_t fgPTMutex; // protects statistics in multithreaded.
+   long fSampleEvery; // sample every Nth allocation per thread; 0: off
+   void* fSelfBase; // load address of this library, to skip its frames
+
+   std::atomic<long> fCurrentHeap;
+   std::atomic<long> fMaxHeap;
+   std::atomic<int> fNumThreads; // number of fThreadData handed out
+   std::atomic<long> fNumDroppedSites; // samples not recorded, table full
+   ThreadData fThreadData[kMaxThreads];
+   ThreadData fOverflowThreadData;
+   CallSite fSites[kNumSites];
+
+   std::atomic<size_t> fBootstrapUsed;
+   alignas(16) char fBootstrap[kBootstrapSize];
+
+   static PerfTrackMallocInterposition fgInstance;
+   static __thread ThreadData* fgThreadData; // this thread's counters
+   static __thread bool fgInSampling; // prevents recursion through backtrace()
 };
 
-pthread_mutex_t PerfTrackMallocInterposition::fgPTMutex = PTHREAD_MUTEX_INITIALIZER;
+PerfTrackMallocInterposition PerfTrackMallocInterposition::fgInstance;
+__thread PerfTrackMallocInterposition::ThreadData* PerfTrackMallocInterposition::fgThreadData = 0;
+__thread bool PerfTrackMallocInterposition::fgInSampling = false;
+
+bool PerfTrackMallocInterposition::Init() {
+   // Initialize forwarding functions and the fifo. Returns false if another
+   // thread (or dlsym, recursively) is initializing; the caller must then use
+   // the bootstrap arena.
+   int expected = kUninitialized;
+   if (!fState.compare_exchange_strong(expected, kInitializing))
+      return false;
+
+   SetFunc((void**)&fPMalloc, "malloc");
+   SetFunc((void**)&fPCalloc, "calloc");
+   SetFunc((void**)&fPRealloc, "realloc");
+   SetFunc((void**)&fPMemalign, "memalign");
+   SetFunc((void**)&fPPosixMemalign, "posix_memalign");
+   SetFunc((void**)&fPFree, "free");
+
+   const char* sample = getenv("PT_SAMPLE");
+   if (sample)
+      fSampleEvery = atol(sample);
+   Dl_info info;
+   if (fSampleEvery > 0 && dladdr((void*)&PerfTrackMallocInterposition::Instance, &info))
+      fSelfBase = info.dli_fbase;
+
+   fState.store(kReady, std::memory_order_release);
+
+   static char envPreload[] = "LD_PRELOAD=";
+   putenv(envPreload);
+
+   // Open the FIFO:
+   static const char* fifoenv = "PT_FIFONAME";
+   const char* fifoname = getenv(fifoenv);
+   if (fifoname) {
+      fFifoFD = open(fifoname, O_WRONLY);
+      if (fFifoFD < 0) {
+         printf("%s:%d: Error opening FIFO %s: %s\n", __FILE__, __LINE__, fifoname, strerror(errno));
+      }
+   } else {
+      printf("%s:%d: %s not set: %s\n", __FILE__, __LINE__, fifoenv, strerror(errno));
+   }
+   return true;
+}
 
-void* PerfTrackMallocInterposition::Malloc(size_t size) {
-   // Malloc with statistics
-   pthread_mutex_lock(&fgPTMutex);
-   char* result = (char *)(*fPMalloc)(size+sizeof(int)+sizeof(size_t));
-   IncHeap(size);
-   pthread_mutex_unlock(&fgPTMutex);
-   
-   *(int *)result=699692586;
-   *(size_t *)(result+sizeof(int))=size;
+void PerfTrackMallocInterposition::SetFunc(void** ppFunc, const char* name) const {
+   // Find the next (i.e. not ours :-) symbol called name.
+   *ppFunc = dlsym(RTLD_NEXT, name);
+   const char* error = dlerror();
+   if (error != NULL) {
+      printf("%s:%d: Error looking for original symbol %s: %s\n", __FILE__, __LINE__, name, error);
+      exit(1);
+   }
+}
 
-   return (void*) (result+sizeof(int)+sizeof(size_t));
+PerfTrackMallocInterposition::ThreadData& PerfTrackMallocInterposition::GetThreadData() {
+   // Return this thread's counters, assigning a slot on first use.
+   if (!fgThreadData) {
+      int slot = fNumThreads.fetch_add(1, std::memory_order_relaxed);
+      fgThreadData = slot < kMaxThreads ? &fThreadData[slot] : &fOverflowThreadData;
+   }
+   return *fgThreadData;
 }
 
-void* PerfTrackMallocInterposition::Realloc(void* ptr, size_t size) {
-   // Realloc with statistics
-  char *result;
-  int v1=699692586;
-  if (ptr!=0) v1=*(int *) ((char*)ptr-sizeof(int)-sizeof(size_t));
-
-  pthread_mutex_lock(&fgPTMutex);
-  if (v1!=699692586 || ptr==0){ 
-    if (ptr==0 && size!=0){ // behaves as malloc   
-       IncHeap(size);
-      result=(char *)(*fPRealloc)(0,size+sizeof(int)+sizeof(size_t));       
-      *(int *)result=699692586;
-      *(size_t *)(result+sizeof(int))=size;
-    }
-    else {
-      result=(char *)(*fPRealloc)(ptr,size); // old realloc call 
-    }
-  }
-  else
-    {
-      size_t v2=*(size_t *) ((char*)ptr-sizeof(size_t));
-      if (size==0){ // behaves as free
-	fPerfData[kPDCurrentHeap]-=v2;
-	result=(char *)(*fPRealloc)((char*)ptr-sizeof(int)-sizeof(size_t),0);
+void* PerfTrackMallocInterposition::BootstrapAlloc(size_t size) {
+   // Allocate from the static arena; used while the forwarding functions are
+   // being resolved. The block is prefixed by its size, for Realloc, in
+   // kBootstrapHeader bytes so that it is as aligned as malloc's.
+   size_t need = (size + kBootstrapHeader + 15) & ~(size_t)15;
+   size_t offset = fBootstrapUsed.fetch_add(need);
+   if (offset + need > kBootstrapSize) {
+      static const char msg[] = "pt_mymalloc: bootstrap arena exhausted\n";
+      write(2, msg, sizeof(msg) - 1);
+      abort();
+   }
+   char* block = fBootstrap + offset;
+   *(size_t*)block = size;
+   return block + kBootstrapHeader;
+}
+
+void PerfTrackMallocInterposition::SampleCallSite(size_t size) {
+   // Attribute size to the current call stack.
+   if (fgInSampling)
+      return;
+   fgInSampling = true;
+
+   void* frames[kSiteDepth + kSiteSkip];
+   int nframes = backtrace(frames, kSiteDepth + kSiteSkip);
+
+   // Skip the frames of this library; how many depends on inlining.
+   int skip = 0;
+   Dl_info info;
+   while (skip < nframes && skip < kSiteSkip && dladdr(frames[skip], &info)
+          && info.dli_fbase == fSelfBase)
+      ++skip;
+   nframes -= skip;
+   if (nframes > kSiteDepth)
+      nframes = kSiteDepth;
+   if (nframes <= 0) {
+      fgInSampling = false;
+      return;
+   }
+
+   // FNV-1a over the return addresses
+   uint64_t hash = 14695981039346656037ULL;
+   for (int i = 0; i < nframes; ++i) {
+      hash ^= (uint64_t)(uintptr_t)frames[skip + i];
+      hash *= 1099511628211ULL;
+   }
+   if (!hash)
+      hash = 1;
+
+   size_t idx = hash & (kNumSites - 1);
+   for (int probe = 0; probe < kNumSites; ++probe, idx = (idx + 1) & (kNumSites - 1)) {
+      CallSite& site = fSites[idx];
+      uint64_t siteHash = site.fHash.load(std::memory_order_acquire);
+      if (!siteHash) {
+         if (site.fHash.compare_exchange_strong(siteHash, hash)) {
+            memcpy(site.fFrames, frames + skip, nframes * sizeof(void*));
+            site.fNumFrames.store(nframes, std::memory_order_release);
+            siteHash = hash;
+         }
       }
-      else{
-         IncHeap(size-v2);
-		 
-	result = (char *)(*fPRealloc)((char*)ptr-sizeof(int)-sizeof(size_t),size+sizeof(int)+sizeof(size_t));
-	*(int *)result=699692586;
-	*(size_t *)(result+sizeof(int))=size;
+      if (siteHash == hash) {
+         site.fCount.fetch_add(1, std::memory_order_relaxed);
+         site.fBytes.fetch_add(size, std::memory_order_relaxed);
+         fgInSampling = false;
+         return;
       }
-    }
-		 
- pthread_mutex_unlock(&fgPTMutex); 
+   }
+   fNumDroppedSites.fetch_add(1, std::memory_order_relaxed);
+   fgInSampling = false;
+}
 
- if (v1!=699692586 || size==0) return (void*) (result); 
-  else return (void*) (result+sizeof(int)+sizeof(size_t)); 
+void PerfTrackMallocInterposition::WriteSites() {
+   // Write the call sites with the largest sampled allocations. Uses only
+   // stack memory, and backtrace_symbols_fd which does not allocate.
+   int fd = 2;
+   const char* sitesFile = getenv("PT_SITES");
+   if (sitesFile) {
+      fd = open(sitesFile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (fd < 0) {
+         printf("%s:%d: Error opening %s: %s\n", __FILE__, __LINE__, sitesFile, strerror(errno));
+         return;
+      }
+   }
 
-}
+   int top[kNumReportedSites];
+   int ntop = 0;
+   for (int i = 0; i < kNumSites; ++i) {
+      if (!fSites[i].fNumFrames.load())
+         continue;
+      long bytes = fSites[i].fBytes.load();
+      int pos = ntop < kNumReportedSites ? ntop++ : kNumReportedSites;
+      while (pos > 0 && fSites[top[pos - 1]].fBytes.load() < bytes) {
+         if (pos < kNumReportedSites)
+            top[pos] = top[pos - 1];
+         --pos;
+      }
+      if (pos < kNumReportedSites)
+         top[pos] = i;
+   }
 
+   char line[256];
+   int len = snprintf(line, sizeof(line), "pt_mymalloc: top allocation sites, sampling every %ld allocations (%ld samples dropped)\n",
+                      fSampleEvery, fNumDroppedSites.load());
+   write(fd, line, len);
+   for (int i = 0; i < ntop; ++i) {
+      CallSite& site = fSites[top[i]];
+      len = snprintf(line, sizeof(line), "#%d: %ld sampled allocations, %ld bytes\n",
+                     i, site.fCount.load(), site.fBytes.load());
+      write(fd, line, len);
+      backtrace_symbols_fd(site.fFrames, site.fNumFrames.load(), fd);
+   }
+   if (fd != 2)
+      close(fd);
+}
 
-void PerfTrackMallocInterposition::Free(void* ptr) {
-   // Free with statistics
-   if (ptr==0) return;
+void* PerfTrackMallocInterposition::Malloc(size_t size) {
+   // Malloc with statistics
+   if (!Ready())
+      return BootstrapAlloc(size);
+   void* result = (*fPMalloc)(size);
+   IncHeap(result);
+   return result;
+}
 
-  int v1=*(int *) ((char*)ptr-sizeof(int)-sizeof(size_t));      
-  if (v1!=699692586){
-     (*fPFree)(ptr);
-     return;
-  }
-  size_t v2=* (size_t *) ((char*)ptr-sizeof(size_t));
+void* PerfTrackMallocInterposition::Calloc(size_t num, size_t size) {
+   // Calloc with statistics
+   if (!Ready()) {
+      // The arena is zero-initialized and never reused.
+      if (size && num > (size_t)-1 / size)
+         return 0;
+      return BootstrapAlloc(num * size);
+   }
+   void* result = (*fPCalloc)(num, size);
+   IncHeap(result);
+   return result;
+}
 
-  pthread_mutex_lock(&fgPTMutex);
+void* PerfTrackMallocInterposition::Realloc(void* ptr, size_t size) {
+   // Realloc with statistics
+   if (!Ready() || IsBootstrap(ptr)) {
+      void* result = Malloc(size);
+      if (result && ptr) {
+         size_t oldSize = *(size_t*)((char*)ptr - kBootstrapHeader);
+         memcpy(result, ptr, oldSize < size ? oldSize : size);
+      }
+      return result;
+   }
+   if (ptr)
+      DecHeap(ptr);
+   void* result = (*fPRealloc)(ptr, size);
+   if (result)
+      IncHeap(result);
+   else if (ptr && size)
+      IncHeap(ptr); // failed, ptr is untouched
+   return result;
+}
 
-  fPerfData[kPDCurrentHeap]-=v2;
- 
-  (*fPFree)((char*)ptr-sizeof(int)-sizeof(size_t)); 
+void* PerfTrackMallocInterposition::Memalign(size_t alignment, size_t size) {
+   // Memalign / aligned_alloc with statistics
+   if (!Ready())
+      return alignment <= 16 ? BootstrapAlloc(size) : 0;
+   void* result = (*fPMemalign)(alignment, size);
+   IncHeap(result);
+   return result;
+}
 
-  pthread_mutex_unlock(&fgPTMutex);
+int PerfTrackMallocInterposition::PosixMemalign(void** memptr, size_t alignment, size_t size) {
+   // Posix_memalign with statistics
+   if (!Ready()) {
+      if (alignment > 16)
+         return ENOMEM;
+      *memptr = BootstrapAlloc(size);
+      return 0;
+   }
+   int ret = (*fPPosixMemalign)(memptr, alignment, size);
+   if (!ret)
+      IncHeap(*memptr);
+   return ret;
+}
 
+void PerfTrackMallocInterposition::Free(void* ptr) {
+   // Free with statistics
+   if (ptr==0 || IsBootstrap(ptr)) return;
+   DecHeap(ptr);
+   (*fPFree)(ptr);
 }
 
 // Replacement symbols:
 
+extern "C" {
+
 void *malloc(size_t size) {
    return PerfTrackMallocInterposition::Instance().Malloc(size);
 }
 
+void *calloc(size_t num, size_t size) {
+   return PerfTrackMallocInterposition::Instance().Calloc(num, size);
+}
+
 void free(void *ptr) {
    PerfTrackMallocInterposition::Instance().Free(ptr);
 }
@@ -200,3 +465,85 @@ void *realloc(void *ptr, size_t size) {
    return PerfTrackMallocInterposition::Instance().Realloc(ptr, size);
 }
 
+int posix_memalign(void **memptr, size_t alignment, size_t size) {
+   return PerfTrackMallocInterposition::Instance().PosixMemalign(memptr, alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+   return PerfTrackMallocInterposition::Instance().Memalign(alignment, size);
+}
+
+void *memalign(size_t alignment, size_t size) {
+   return PerfTrackMallocInterposition::Instance().Memalign(alignment, size);
+}
+
+void *valloc(size_t size) {
+   return PerfTrackMallocInterposition::Instance().Memalign(sysconf(_SC_PAGESIZE), size);
+}
+
+} // extern "C"
+
+// operator new / delete usually end up in malloc / free, but not necessarily
+// through the PLT; replace them to be sure they are accounted for.
+
+void *operator new(size_t size) {
+   void *ptr = PerfTrackMallocInterposition::Instance().Malloc(size ? size : 1);
+   if (!ptr) throw std::bad_alloc();
+   return ptr;
+}
+
+void *operator new[](size_t size) {
+   return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t&) noexcept {
+   return PerfTrackMallocInterposition::Instance().Malloc(size ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t&) noexcept {
+   return PerfTrackMallocInterposition::Instance().Malloc(size ? size : 1);
+}
+
+void operator delete(void *ptr) noexcept {
+   PerfTrackMallocInterposition::Instance().Free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+   PerfTrackMallocInterposition::Instance().Free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+   PerfTrackMallocInterposition::Instance().Free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+   PerfTrackMallocInterposition::Instance().Free(ptr);
+}
+
+#ifdef __cpp_aligned_new
+void *operator new(size_t size, std::align_val_t alignment) {
+   void *ptr = PerfTrackMallocInterposition::Instance().Memalign((size_t)alignment, size ? size : 1);
+   if (!ptr) throw std::bad_alloc();
+   return ptr;
+}
+
+void *operator new[](size_t size, std::align_val_t alignment) {
+   return operator new(size, alignment);
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept {
+   PerfTrackMallocInterposition::Instance().Free(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t) noexcept {
+   PerfTrackMallocInterposition::Instance().Free(ptr);
+}
+
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept {
+   PerfTrackMallocInterposition::Instance().Free(ptr);
+}
+
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept {
+   PerfTrackMallocInterposition::Instance().Free(ptr);
+}
+#endif